@@ -0,0 +1,537 @@
+/*
+	benchmark.cpp
+
+	Microbenchmarks for the CPU hot paths of the piano model, run at keyboard sizes from 5 to 10,000 keys:
+	shape vertex and normal generation, Piano construction, the per-key state update and action lookup from simulateTick()
+	and the object placement and matrix chain through each key rig, both one object at a time and through
+	each path of batchTransform. The batch paths also report their largest difference from the glm chain,
+	with the objects placed by the original offset chain rather than the rigs,
+	and the run exits with an error if any path differs by more than MAX_ERROR.
+	Picking is measured as a refit of the bounding volume hierarchy with every key moving, and as a single ray cast,
+	and the render queue as filling and sorting the draws of every object.
+	Built against the stub wrapper_glfw.h in this folder, so no window, context or GL library is needed.
+	Results are printed as JSON in the Google Benchmark layout, so runs can be compared with its tools.
+
+	Build from the code folder:
+		g++ -O2 -std=c++11 -Ibenchmark -Iheaders benchmark/benchmark.cpp classes/Shape.cpp classes/Cuboid.cpp
+			classes/Tetrahedron.cpp classes/Cylinder.cpp classes/Piano.cpp classes/ActionClip.cpp classes/Action.cpp classes/Transform.cpp
+			classes/TransformAVX2.cpp classes/Picker.cpp classes/KeyRig.cpp
+			classes/RenderQueue.cpp -o piano_benchmark
+	Run:
+		piano_benchmark [filter] > results.json
+*/
+
+#include "wrapper_glfw.h" //GL type stubs
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp> //glm core
+#include "glm/gtc/matrix_transform.hpp" //matrix extension
+#include "Shape.h"
+#include "Cuboid.h"
+#include "Tetrahedron.h"
+#include "Cylinder.h"
+#include "Piano.h"
+#include "Transform.h"
+#include "ActionClip.h"
+#include "Action.h"
+#include "KeyRig.h"
+#include "RenderQueue.h"
+#include "Picker.h"
+
+using namespace std;
+using namespace glm;
+
+static const int SIZES[] = { 5, 88, 1000, 10000 }; //keyboard sizes to run each benchmark at
+static const double MIN_TIME = 0.2; //minimum seconds to run each benchmark for
+static const double MAX_ERROR = 1e-5; //largest difference from the glm chain a batch path may have
+
+static volatile float sink; //results are written here so the compiler cannot remove the work
+
+typedef function<void()> Body; //one iteration of a benchmark
+typedef function<Body(int)> Setup; //builds the state for a keyboard size and returns the body to time
+
+struct Result
+{
+	string name;
+	int keys;
+	long iterations;
+	double real_time; //nanoseconds per iteration
+	double cpu_time;
+	double max_error; //largest difference from the reference, negative when not checked
+};
+
+/*
+	Shapes exposing their generate functions, so each can be measured in isolation from construction.
+*/
+class BenchCuboid : public Cuboid
+{
+	public:
+		BenchCuboid() : Cuboid(1.2f, 0.2f, 0.2f, vec4(1.0f)) { }
+		float vertexSum() { return generateVertices()[0].x; }
+		float normalSum() { return generateNormals()[0].x; }
+};
+
+class BenchTetrahedron : public Tetrahedron
+{
+	public:
+		BenchTetrahedron() : Tetrahedron(0.15f, 0.65f, 0.15f, vec4(1.0f)) { }
+		float vertexSum() { return generateVertices()[0].x; }
+		float normalSum() { return generateNormals()[0].x; }
+};
+
+class BenchCylinder : public Cylinder
+{
+	public:
+		BenchCylinder() : Cylinder(0.05f, 5.0f, vec4(1.0f)) { }
+		float vertexSum() { return generateVertices()[0].x; }
+		float normalSum() { return generateNormals()[0].x; }
+};
+
+/*
+	Function to time a benchmark body, growing the iteration count until it runs for at least MIN_TIME.
+*/
+Result measure(string name, int keys, Body body)
+{
+	long iterations = 1;
+	for (;;)
+	{
+		clock_t cpu_start = clock();
+		auto start = chrono::steady_clock::now();
+		for (long i = 0; i < iterations; i++) body();
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		double cpu = double(clock() - cpu_start) / CLOCKS_PER_SEC;
+
+		if (elapsed >= MIN_TIME || iterations >= 1000000000L)
+			return Result{ name + "/" + to_string(keys), keys, iterations, elapsed * 1e9 / iterations, cpu * 1e9 / iterations, -1.0 };
+
+		//aim for MIN_TIME on the next run, growing by at least 2x and at most 10x
+		double scale = elapsed > 0 ? 1.4 * MIN_TIME / elapsed : 10.0;
+		iterations = (long)(iterations * (scale < 2.0 ? 2.0 : (scale > 10.0 ? 10.0 : scale)));
+	}
+}
+
+/*
+	State for a row of keys, with every key part way through a press.
+	Keys are staggered so all stages of the movement are present.
+*/
+struct Keys
+{
+	int count;
+	unique_ptr<bool[]> moving_up, moving_down;
+	vector<int> increment;
+	vector<Piano> piano;
+	vector<KeyRig> rig;
+	int limit;
+	int moving;
+	ActionClip clip;
+
+	Keys(int count, bool models) : count(count), moving_up(new bool[count]), moving_down(new bool[count]), increment(count), limit(150), moving(count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			increment[i] = (i * 37) % limit;
+			moving_up[i] = (i % 2 == 0);
+			moving_down[i] = !moving_up[i];
+		}
+		if (models)
+		{
+			for (int i = 0; i < count; i++) piano.push_back(Piano(i % 2 == 0 ? "natural" : "sharp"));
+			for (int i = 0; i < count; i++) rig.push_back(KeyRig(piano[i], -1.0f));
+		}
+		clip.bake();
+	}
+
+	//the baked key press for a key, as looked up by simulateTick()
+	ActionSample action(int key)
+	{
+		return clip.sample(ActionClip::velocity(limit), ActionClip::phase(increment[key], limit, moving_up[key], moving_down[key]));
+	}
+};
+
+static const vec3 ANGLE = vec3(10.0f, 20.0f, 30.0f); //object rotation used by the transform benchmarks
+
+/*
+	Function to return a camera matrix like the one built in display().
+*/
+mat4 viewMatrix()
+{
+	mat4 View = lookAt(vec3(0, 0, 8), vec3(0, 0, 0), vec3(0, 1, 0));
+	View = rotate(View, 15.0f, vec3(1, 0, 0));
+	View = rotate(View, -25.0f, vec3(0, 1, 0));
+	return View;
+}
+
+/*
+	Function to place and pose every object of every key, through each key rig, as simulateTick() does before batchTransform.
+*/
+void poseKeys(Keys &k, PartPoses &poses)
+{
+	float zpos = -2.0f;
+	for (int model = 0; model < k.count; model++)
+	{
+		vec3 initial = vec3(0 - 2.0f, 0 - 1.0f, zpos / 3.6);
+		k.rig[model].pose(initial, k.action(model), poses, model * Piano::OBJECTS);
+		zpos += 1.0f;
+	}
+}
+
+/*
+	State for picking over a row of keys: the hierarchy, the object transforms at two steps of the key presses
+	to refit between, and rays from in front of the keyboard aimed at the centre of every part.
+*/
+struct Picking
+{
+	Keys keys;
+	vector<mat4> transforms[2];
+	vector<vec3> centre, halfsize;
+	vector<vec3> origin, direction;
+	Picker picker;
+	int step, ray;
+
+	Picking(int count) : keys(count, true), step(0), ray(0)
+	{
+		int parts = count * Piano::OBJECTS;
+		PartPoses poses(parts);
+		vector<mat3> rotation(parts);
+		for (int i = 0; i < 2; i++)
+		{
+			transforms[i].resize(parts);
+			poseKeys(keys, poses);
+			batchTransform(poses, mat3(1.0f), mat3(1.0f), transforms[i].data(), rotation.data());
+			advanceKeys(keys.count, keys.moving_up.get(), keys.moving_down.get(), keys.increment.data());
+		}
+
+		for (int key = 0; key < count; key++)
+		{
+			for (int shape = 0; shape < Piano::OBJECTS; shape++)
+			{
+				vec3 low, high;
+				keys.piano[key].getObjectByIndex(shape).getBounds(low, high);
+				centre.push_back((low + high) / 2.0f);
+				halfsize.push_back((high - low) / 2.0f);
+			}
+		}
+		picker.build(transforms[0].data(), centre.data(), halfsize.data(), parts);
+
+		for (int part = 0; part < parts; part++)
+		{
+			vec3 from = vec3(0.0f, 2.0f, 12.0f + 0.25f * count);
+			origin.push_back(from);
+			direction.push_back(normalize(vec3(transforms[0][part][3]) - from));
+		}
+	}
+};
+
+/*
+	Function to find the largest difference between the batch matrices and those from objectTransform and normalMatrix,
+	with the objects placed by the reference chain in placeObjects rather than by each rig, so the rig is checked too.
+	Translations are compared relative to their size, as keys far along the z-axis lose absolute precision.
+*/
+double batchError(Keys &k, mat4 model[], mat3 normal[])
+{
+	mat4 View = viewMatrix();
+	double error = 0.0;
+	float zpos = -2.0f;
+	for (int key = 0; key < k.count; key++)
+	{
+		vec3 initial = vec3(0 - 2.0f, 0 - 1.0f, zpos / 3.6);
+		GLfloat wirecentre = -1.0f + k.piano[key].key.height + k.piano[key].damperarm.height;
+		vec3 position[Piano::OBJECTS], pivotpoint;
+		placeObjects(k.piano[key], initial, position, pivotpoint);
+
+		for (int shape = 0; shape < Piano::OBJECTS; shape++)
+		{
+			mat4 m = objectTransform(k.piano[key], shape, position[shape], pivotpoint, wirecentre, ANGLE, k.action(key));
+			mat3 n = normalMatrix(View, m);
+			int part = key * Piano::OBJECTS + shape;
+			for (int col = 0; col < 4; col++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					error = fmax(error, fabs(m[col][row] - model[part][col][row]) / fmax(1.0f, fabs(m[col][row])));
+					if (col < 3 && row < 3) error = fmax(error, fabs(n[col][row] - normal[part][col][row]));
+				}
+			}
+		}
+		zpos += 1.0f;
+	}
+	return error;
+}
+
+/*
+	The benchmarks, each given as a name, a setup function for a keyboard size
+	and, where the results are checked, a path of batchTransform.
+*/
+vector<pair<string, Setup>> benchmarks()
+{
+	vector<pair<string, Setup>> list;
+
+	list.push_back({ "Cuboid/generateVertices", [](int keys) -> Body
+	{
+		auto shapes = make_shared<vector<BenchCuboid>>(keys);
+		return [=]() { for (BenchCuboid &shape : *shapes) sink = shape.vertexSum(); };
+	} });
+
+	list.push_back({ "Tetrahedron/generateVertices", [](int keys) -> Body
+	{
+		auto shapes = make_shared<vector<BenchTetrahedron>>(keys);
+		return [=]() { for (BenchTetrahedron &shape : *shapes) sink = shape.vertexSum(); };
+	} });
+
+	list.push_back({ "Cylinder/generateVertices", [](int keys) -> Body
+	{
+		auto shapes = make_shared<vector<BenchCylinder>>(keys);
+		return [=]() { for (BenchCylinder &shape : *shapes) sink = shape.vertexSum(); };
+	} });
+
+	list.push_back({ "Shape/generateNormals", [](int keys) -> Body
+	{
+		//Shape::generateNormals, over the cuboid and tetrahedron triangle lists
+		auto cuboids = make_shared<vector<BenchCuboid>>(keys);
+		auto tetrahedrons = make_shared<vector<BenchTetrahedron>>(keys);
+		return [=]()
+		{
+			for (BenchCuboid &shape : *cuboids) sink = shape.normalSum();
+			for (BenchTetrahedron &shape : *tetrahedrons) sink = shape.normalSum();
+		};
+	} });
+
+	list.push_back({ "Cylinder/generateNormals", [](int keys) -> Body
+	{
+		auto shapes = make_shared<vector<BenchCylinder>>(keys);
+		return [=]() { for (BenchCylinder &shape : *shapes) sink = shape.normalSum(); };
+	} });
+
+	list.push_back({ "Piano/construct", [](int keys) -> Body
+	{
+		return [=]()
+		{
+			for (int i = 0; i < keys; i++) sink = Piano(i % 2 == 0 ? "natural" : "sharp").key.width;
+		};
+	} });
+
+	list.push_back({ "Action/updateKeys", [](int keys) -> Body
+	{
+		//the per-key state update from simulateTick(), keys are pressed again as they come to rest
+		auto state = make_shared<Keys>(keys, false);
+		return [=]()
+		{
+			Keys &k = *state;
+			updateKeys(k.count, k.moving_up.get(), k.moving_down.get(), k.increment.data(), k.limit, k.moving);
+			advanceKeys(k.count, k.moving_up.get(), k.moving_down.get(), k.increment.data());
+			for (int i = 0; i < k.count; i++)
+			{
+				if (!k.moving_up[i] && !k.moving_down[i]) { k.moving_up[i] = true; k.moving++; }
+			}
+			sink = (float)k.moving;
+		};
+	} });
+
+	list.push_back({ "ActionClip/sample", [](int keys) -> Body
+	{
+		//the baked key press lookup for every key, at every velocity in turn
+		auto state = make_shared<Keys>(keys, false);
+		auto velocity = make_shared<int>(0);
+		return [=]()
+		{
+			Keys &k = *state;
+			k.limit = 50 + 50 * (*velocity = (*velocity + 1) % 10);
+			float sum = 0.0f;
+			for (int i = 0; i < k.count; i++) sum += k.action(i).hammer;
+			sink = sum;
+		};
+	} });
+
+	list.push_back({ "Action/objectTransform", [](int keys) -> Body
+	{
+		//the object placement and matrix chain for every object of every key, as drawn by display()
+		auto state = make_shared<Keys>(keys, true);
+		mat4 View = mat4(1.0f);
+		return [=]()
+		{
+			Keys &k = *state;
+			float zpos = -2.0f;
+			for (int model = 0; model < k.count; model++)
+			{
+				vec3 initial = vec3(0 - 2.0f, 0 - 1.0f, zpos / 3.6);
+				GLfloat wirecentre = -1.0f + k.piano[model].key.height + k.piano[model].damperarm.height;
+				vec3 position[Piano::OBJECTS], pivotpoint;
+				k.rig[model].place(initial, position, pivotpoint);
+
+				ActionSample action = k.action(model);
+
+				for (int shape = 0; shape < Piano::OBJECTS; shape++)
+				{
+					mat4 m = objectTransform(k.piano[model], shape, position[shape], pivotpoint, wirecentre, ANGLE, action);
+					mat3 n = normalMatrix(View, m);
+					sink = m[3][0] + n[0][0];
+				}
+				zpos += 1.0f;
+			}
+		};
+	} });
+
+	list.push_back({ "Picker/update", [](int keys) -> Body
+	{
+		//refitting the hierarchy each tick with every part moved, alternating between two steps of the key presses
+		auto state = make_shared<Picking>(keys);
+		return [=]()
+		{
+			Picking &p = *state;
+			p.step = 1 - p.step;
+			p.picker.update(p.transforms[p.step].data());
+			sink = (float)p.picker.refitted;
+		};
+	} });
+
+	list.push_back({ "Picker/pick", [](int keys) -> Body
+	{
+		//one ray cast, each aimed at the next part in turn
+		auto state = make_shared<Picking>(keys);
+		return [=]()
+		{
+			Picking &p = *state;
+			float distance;
+			p.ray = (p.ray + 1) % (int)p.origin.size();
+			sink = (float)p.picker.pick(p.origin[p.ray], p.direction[p.ray], distance) + distance;
+		};
+	} });
+
+	list.push_back({ "RenderQueue/sort", [](int keys) -> Body
+	{
+		//the draws of every object queued with their sort keys as display() does, then sorted
+		auto queue = make_shared<RenderQueue>();
+		auto depth = make_shared<vector<float>>(keys * Piano::OBJECTS);
+		for (int i = 0; i < (int)depth->size(); i++) (*depth)[i] = 5.0f + (float)((i * 7919) % 1000) / 20.0f;
+		return [=]()
+		{
+			queue->clear();
+			for (int part = 0; part < (int)depth->size(); part++)
+			{
+				int shape = part % Piano::OBJECTS;
+				DrawItem draw = { 0, part * 36, 36, part };
+				queue->push(RenderQueue::makeKey(0, 0, 0, 0, shape, (*depth)[part], 100.0f), draw);
+			}
+			queue->sort();
+			sink = (float)queue->item(0).first;
+		};
+	} });
+
+	return list;
+}
+
+/*
+	Function to set up the batch transform benchmark for a path, recording its error against the glm chain.
+	Times the whole batch as simulateTick() runs it: pose every object through its rig, then transform them together.
+*/
+Body batchBenchmark(int keys, TransformPath path, double &error)
+{
+	auto state = make_shared<Keys>(keys, true);
+	auto poses = make_shared<PartPoses>(keys * Piano::OBJECTS);
+	auto model = make_shared<vector<mat4>>(keys * Piano::OBJECTS);
+	auto normal = make_shared<vector<mat3>>(keys * Piano::OBJECTS);
+	mat3 object = objectRotation(ANGLE), view = mat3(viewMatrix());
+
+	Body body = [=]()
+	{
+		poseKeys(*state, *poses);
+		batchTransform(*poses, object, view, model->data(), normal->data(), path);
+		sink = (*model)[0][3][0] + (*normal)[0][0][0];
+	};
+
+	body();
+	error = batchError(*state, model->data(), normal->data());
+	return body;
+}
+
+/*
+	Function to print the results as Google Benchmark JSON.
+*/
+void printResults(vector<Result> &results)
+{
+	time_t now = time(0);
+	char date[64];
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+	cout << "{\n";
+	cout << "  \"context\": {\n";
+	cout << "    \"date\": \"" << date << "\",\n";
+	cout << "    \"executable\": \"piano_benchmark\",\n";
+	cout << "    \"library_build_type\": \"release\"\n";
+	cout << "  },\n";
+	cout << "  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		Result &r = results[i];
+		cout << "    {\n";
+		cout << "      \"name\": \"" << r.name << "\",\n";
+		cout << "      \"run_name\": \"" << r.name << "\",\n";
+		cout << "      \"run_type\": \"iteration\",\n";
+		cout << "      \"iterations\": " << r.iterations << ",\n";
+		cout << "      \"real_time\": " << r.real_time << ",\n";
+		cout << "      \"cpu_time\": " << r.cpu_time << ",\n";
+		cout << "      \"time_unit\": \"ns\",\n";
+		cout << "      \"keys\": " << r.keys << ",\n";
+		if (r.max_error >= 0) cout << "      \"max_error\": " << r.max_error << ",\n";
+		cout << "      \"keys_per_second\": " << r.keys * 1e9 / r.real_time << "\n";
+		cout << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	cout << "  ]\n";
+	cout << "}" << endl;
+}
+
+/*
+	Function is the entry point of the benchmarks.
+	An optional argument runs only the benchmarks whose name contains it.
+*/
+int main(int argc, char* argv[])
+{
+	string filter = argc > 1 ? argv[1] : "";
+
+	vector<Result> results;
+	for (auto &benchmark : benchmarks())
+	{
+		if (benchmark.first.find(filter) == string::npos) continue;
+
+		for (int keys : SIZES)
+		{
+			Body body = benchmark.second(keys);
+			results.push_back(measure(benchmark.first, keys, body));
+			cerr << results.back().name << ": " << results.back().real_time << " ns" << endl; //progress, kept off the JSON output
+		}
+	}
+
+	//each path of the batch transform, skipping paths this processor lacks
+	const pair<string, TransformPath> paths[] = { { "scalar", TRANSFORM_SCALAR }, { "sse", TRANSFORM_SSE }, { "avx2", TRANSFORM_AVX2 } };
+	bool failed = false;
+	for (auto &path : paths)
+	{
+		string name = "Transform/batchTransform/" + path.first;
+		if (name.find(filter) == string::npos || path.second > transformPath()) continue;
+
+		for (int keys : SIZES)
+		{
+			double error;
+			Body body = batchBenchmark(keys, path.second, error);
+			results.push_back(measure(name, keys, body));
+			results.back().max_error = error;
+			cerr << results.back().name << ": " << results.back().real_time << " ns, max error " << error << endl;
+
+			if (error > MAX_ERROR)
+			{
+				cerr << "Error: " << results.back().name << " differs from the glm chain by more than " << MAX_ERROR << endl;
+				failed = true;
+			}
+		}
+	}
+
+	printResults(results);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+/*
+	wrapper_glfw.h (benchmark stub)
+
+	Stands in for the glfw wrapper header when building the benchmarks.
+	Declares only the GL types used by the shape and action code, so no window, context or GL library is needed.
+*/
+
+#include <string> //the real wrapper header brings this in for the shape and piano classes
+
+typedef float GLfloat;
+typedef int GLint;
+typedef int GLsizei;
+typedef unsigned int GLuint;
+
+typedef unsigned int GLenum;
\ No newline at end of file
@@ -0,0 +1,154 @@
+/*
+	Action.cpp
+
+	Functions to simulate the piano action: the movement of each key from press to rest,
+	and the reference placement and transform of each object; the objects are placed and posed by KeyRig.
+	The references keep the original chain of offsets and matrices, so the rig can be checked against them.
+	Makes no GL calls, so it can be run and measured without a window or context.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <glm/glm.hpp> //glm core
+#include "glm/gtc/matrix_transform.hpp" //matrix extension
+#include "Shape.h"
+#include "Cuboid.h"
+#include "Tetrahedron.h"
+#include "Cylinder.h"
+#include "Piano.h"
+#include "Transform.h"
+#include "ActionClip.h"
+#include "Action.h"
+
+using namespace glm;
+
+/*
+	Function to update the direction of every key before drawing.
+	A key at the top of its movement begins moving down, a key at the bottom comes to rest.
+*/
+void updateKeys(int keys, bool moving_up[], bool moving_down[], int increment[], int limit, int &moving)
+{
+	for (int i = 0; i < keys; i++)
+	{
+		if (increment[i] == limit) //if the key has reached maximum height
+		{
+			moving_up[i] = false; //key is no longer moving up
+			moving_down[i] = true; //key is now moving down
+		}
+		else if (moving_down[i] && increment[i] == 0) //if the key is moving down and the minimum height is reached
+		{
+			moving_down[i] = false; //object is no longer moving down
+			moving--; //remove the objects from the count of objects currently moving
+		}
+	}
+}
+
+/*
+	Function to step every moving key after drawing.
+*/
+void advanceKeys(int keys, bool moving_up[], bool moving_down[], int increment[])
+{
+	for (int j = 0; j < keys; j++)
+	{
+		if (moving_up[j]) increment[j]++; //if the model is currently moving upwards, increase the position of the key arm
+		if (moving_down[j]) increment[j]--; //if the model is currently moving downwards, decrease the position of the key arm
+	}
+}
+
+/*
+	Function to position each object within a key model, starting from the key at the initial position.
+	Reference for the positions and point of pivot calculated by KeyRig::place.
+	Fills position with one entry per object, in the order of Piano::getObjectByIndex, and sets the point of pivot.
+*/
+void placeObjects(Piano &piano, vec3 initial, vec3 position[], vec3 &pivotpoint)
+{
+	//position key
+	vec3 translatevec = initial;
+	position[0] = translatevec;
+
+	//position lever
+	translatevec += vec3(piano.key.width / 2 + piano.lever.width / 2, piano.key.height / 2 - piano.lever.height / 2, 0);
+	position[1] = translatevec;
+
+	//position pivot
+	translatevec += vec3(-0.8f, -piano.pivot.height / 2 - piano.lever.height / 2, 0.0);
+	pivotpoint = translatevec + vec3(0.0, piano.pivot.height / 2 + piano.lever.height / 2, 0.0);
+	position[2] = translatevec;
+
+	//position hammerarm
+	translatevec += vec3(0.8f, piano.pivot.height / 2 + piano.lever.height + piano.hammerarm.height / 2, 0.0);
+	position[3] = translatevec;
+
+	//position hammer
+	translatevec += vec3(0.0, piano.hammerarm.height / 2 + piano.hammer.height / 2, 0.0);
+	position[4] = translatevec;
+
+	//position damperarm
+	translatevec += vec3(1.0f, -piano.hammer.height / 2 - piano.hammerarm.height + piano.damperarm.height / 2, 0.0);
+	position[5] = translatevec;
+
+	//position damper
+	translatevec += vec3(0.0, piano.damperarm.height / 2 + piano.damper.height / 2, 0.0);
+	position[6] = translatevec;
+
+	//position wire, relative to the damper
+	position[7] = translatevec;
+}
+
+/*
+	Function to calculate the model matrix of the specified shape within a key model.
+	Reference for the matrices calculated by KeyRig::pose and batchTransform, one object at a time.
+	Handles each object type individually, including:
+	Rotates the key and lever by the sampled key angle,
+	Rotates the pivot tetrahedron to position it side on,
+	Translates the hammer/arm and damper/arm by their sampled lift,
+	Vibrates the wire by its sampled displacement
+*/
+mat4 objectTransform(Piano &piano, int shape, vec3 translatevec, vec3 pivotpoint, GLfloat wirecentre, vec3 angle, ActionSample action)
+{
+	mat4 model = mat4(objectRotation(angle)); //create the model variable for the shape, rotated with the object
+
+	if (shape < 2) //key or lever
+	{
+		//translate back to the origin, rotate around the origin the height required, translate back to original position
+		model = translate(model, pivotpoint);
+		model = rotate(model, action.key, vec3(0, 0, 1));
+		model = translate(model, -pivotpoint);
+		model = translate(model, translatevec);
+	}
+	else if (shape == 2) //pivot
+	{
+		//rotate the pivot shape to be side on
+		model = translate(model, pivotpoint);
+		model = rotate(model, 65.0f, vec3(0, 1, 0));
+		model = translate(model, -pivotpoint);
+		model = translate(model, translatevec);
+	}
+	else if (shape >= 3 && shape <= 6) //hammerarm, hammer, damperarm or damper
+	{
+		GLfloat travel = wirecentre - piano.damperarm.height / 2; //distance between the hammer at rest and the wire
+		vec3 difference = vec3(0.0, action.hammer * travel, 0.0); //calculate the difference for the hammer/arm
+
+		if (shape > 4) difference = vec3(0.0, action.damper * (travel + 0.31f), 0.0); //calculate the difference for the damper/arm
+
+		model = translate(model, translatevec + difference); //translate the hammer/damper objects to required height
+	}
+	else if (shape == 7) //wire
+	{
+		//rotate the cylinder so it's lying horizontally, parallel to the x-axis
+		model = translate(model, translatevec);
+		model = rotate(model, 90.0f, vec3(0, 0, 1));
+		model = translate(model, vec3(-piano.damper.height / 2 - piano.wire.width / 2, 1.5f, 0.05f));
+		model = translate(model, vec3(action.wire, 0.0f, 0.0f)); //vibrate the wire
+	}
+
+	return model;
+}
+
+/*
+	Function to calculate the normal matrix of an object, given the camera and model matrices.
+*/
+mat3 normalMatrix(mat4 View, mat4 model)
+{
+	return transpose(inverse(mat3(View * model)));
+}
@@ -0,0 +1,151 @@
+/*
+	ActionClip.cpp
+
+	Animation clip of the piano action, covering the whole key press: the key going down,
+	hammer escapement and strike, the hammer rebounding onto its check, the damper lifting and falling
+	and the wire vibrating once struck.
+	The curves are baked into a table at startup for a range of hammer velocities, so each key only
+	needs an interpolated lookup per frame rather than evaluating the curves.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <cmath>
+#include "ActionClip.h"
+
+//moments within the key press, as a fraction of the whole press
+static const GLfloat KEY_DOWN = 0.45f; //key reaches the bottom of its travel
+static const GLfloat ESCAPEMENT = 0.35f; //hammer leaves the lever and flies freely
+static const GLfloat STRIKE = 0.5f; //hammer strikes the wire
+static const GLfloat CHECK = 0.65f; //hammer has fallen back onto its check
+static const GLfloat RELEASE = 0.55f; //key begins to return
+
+static const GLfloat KEY_ANGLE = 18.0f; //angle of the key at the bottom of its travel
+static const GLfloat ESCAPEMENT_LIFT = 0.85f; //hammer lift at escapement
+static const GLfloat CHECK_LIFT = 0.6f; //hammer lift when caught by the check
+
+/*
+	Function to smoothly step from 0 to 1 as x moves from a to b.
+*/
+static GLfloat smoothStep(GLfloat a, GLfloat b, GLfloat x)
+{
+	GLfloat t = (x - a) / (b - a);
+	t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+	return t * t * (3.0f - 2.0f * t);
+}
+
+/*
+	Function to return the travel of the key, from 0 at rest to 1 fully down.
+	A faster press drives the key down more sharply at the start.
+*/
+static GLfloat keyTravel(GLfloat velocity, GLfloat phase)
+{
+	GLfloat x = phase / KEY_DOWN;
+	x = x > 1.0f ? 1.0f : x;
+	GLfloat press = 1.0f - pow(1.0f - x, 1.0f + 2.0f * velocity);
+	return press * (1.0f - smoothStep(RELEASE, 1.0f, phase));
+}
+
+ActionClip::ActionClip() { }
+
+/*
+	Function to evaluate the action curves for a hammer velocity (0 slowest, 1 fastest) at a phase of the key press (0 to 1).
+*/
+ActionSample ActionClip::evaluate(GLfloat velocity, GLfloat phase)
+{
+	ActionSample sample;
+	GLfloat key = keyTravel(velocity, phase);
+	sample.key = KEY_ANGLE * key;
+
+	//hammer
+	if (phase < ESCAPEMENT) //pushed up by the lever
+	{
+		sample.hammer = ESCAPEMENT_LIFT * key / keyTravel(velocity, ESCAPEMENT);
+	}
+	else if (phase < STRIKE) //flying freely towards the wire
+	{
+		sample.hammer = ESCAPEMENT_LIFT + (1.0f - ESCAPEMENT_LIFT) * (phase - ESCAPEMENT) / (STRIKE - ESCAPEMENT);
+	}
+	else if (phase < CHECK) //rebounding from the wire onto the check, bouncing harder after a faster strike
+	{
+		GLfloat s = (phase - STRIKE) / (CHECK - STRIKE);
+		sample.hammer = CHECK_LIFT + (1.0f - CHECK_LIFT) * (1.0f - s) * (1.0f - s) + 0.05f * velocity * sin(3.141592f * s);
+	}
+	else //returning to rest with the key
+	{
+		sample.hammer = CHECK_LIFT * key / keyTravel(velocity, CHECK);
+	}
+
+	//damper lifts off the wire as the key goes down and falls back as it returns
+	sample.damper = smoothStep(0.1f, 0.3f, phase) * (1.0f - smoothStep(0.6f, 0.85f, phase));
+
+	//wire vibrates once struck, louder and tighter for a faster hammer, dying away over the rest of the press
+	sample.wire = 0.0f;
+	if (phase > STRIKE)
+	{
+		GLfloat s = phase - STRIKE;
+		sample.wire = (0.02f + 0.06f * velocity) * exp(-6.0f * s) * sin(2.0f * 3.141592f * (8.0f + 16.0f * velocity) * s);
+	}
+
+	return sample;
+}
+
+/*
+	Function to bake the action curves into the table, for VELOCITIES velocities evenly spaced from slowest to fastest.
+*/
+void ActionClip::bake()
+{
+	samples.resize(VELOCITIES * SAMPLES);
+	for (int v = 0; v < VELOCITIES; v++)
+	{
+		for (int s = 0; s < SAMPLES; s++)
+		{
+			samples[v * SAMPLES + s] = evaluate((GLfloat)v / (VELOCITIES - 1), (GLfloat)s / (SAMPLES - 1));
+		}
+	}
+}
+
+/*
+	Function to sample the baked action for a velocity and phase, both 0 to 1.
+	Interpolates between the nearest samples and the nearest velocities.
+*/
+ActionSample ActionClip::sample(GLfloat velocity, GLfloat phase)
+{
+	velocity = velocity < 0.0f ? 0.0f : (velocity > 1.0f ? 1.0f : velocity);
+	phase = phase < 0.0f ? 0.0f : (phase > 1.0f ? 1.0f : phase);
+
+	GLfloat row = velocity * (VELOCITIES - 1), column = phase * (SAMPLES - 1);
+	int v = (int)row, s = (int)column;
+	if (v > VELOCITIES - 2) v = VELOCITIES - 2;
+	if (s > SAMPLES - 2) s = SAMPLES - 2;
+	GLfloat fv = row - v, fs = column - s;
+
+	const ActionSample *a = &samples[v * SAMPLES + s], *b = a + SAMPLES; //two neighbouring velocities
+	GLfloat w00 = (1.0f - fv) * (1.0f - fs), w01 = (1.0f - fv) * fs, w10 = fv * (1.0f - fs), w11 = fv * fs;
+
+	ActionSample result;
+	result.key = w00 * a[0].key + w01 * a[1].key + w10 * b[0].key + w11 * b[1].key;
+	result.hammer = w00 * a[0].hammer + w01 * a[1].hammer + w10 * b[0].hammer + w11 * b[1].hammer;
+	result.damper = w00 * a[0].damper + w01 * a[1].damper + w10 * b[0].damper + w11 * b[1].damper;
+	result.wire = w00 * a[0].wire + w01 * a[1].wire + w10 * b[0].wire + w11 * b[1].wire;
+	return result;
+}
+
+/*
+	Function to return the hammer velocity, 0 to 1, for a hammer speed limit between 500 (slowest) and 50 (fastest).
+*/
+GLfloat ActionClip::velocity(int limit)
+{
+	return (500.0f - limit) / 450.0f;
+}
+
+/*
+	Function to return the phase of a key press, 0 to 1, from the position state of the key.
+	The key rises to the limit and falls back, so the strike is half way through.
+*/
+GLfloat ActionClip::phase(int increment, int limit, bool moving_up, bool moving_down)
+{
+	if (moving_up) return (GLfloat)increment / (2 * limit);
+	if (moving_down) return (GLfloat)(2 * limit - increment) / (2 * limit);
+	return 0.0f; //at rest
+}
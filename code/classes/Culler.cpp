@@ -0,0 +1,295 @@
+/*
+	Culler.cpp
+
+	Culling of keys and their parts before drawing.
+	Frustum culling tests the bounding box of each key against the six planes of the view frustum,
+	and only tests the parts of a key that straddles the edge of the view.
+	Occlusion culling wraps the drawing of each key in an occlusion query, with the keys drawn front to back
+	so each is tested against the keys in front of it. A key whose query found no samples
+	is skipped in the following frames, with only its bounding box drawn into a query, without colour or depth,
+	after the rest of the scene, to find when it comes back into view. Results are read a frame late and only when
+	available, so the CPU never waits on the GPU; a key with no result yet is drawn.
+	Only whole keys are queried; parts hidden inside their own key are still drawn.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp> //glm core
+#include "glm/gtc/matrix_transform.hpp" //matrix extension
+#include "Culler.h"
+
+using namespace std;
+using namespace glm;
+
+enum { OUTSIDE, INTERSECTS, INSIDE }; //result of testing a box against the frustum
+
+Culler::Culler() : boxbuffer(0), mode(CULL_FRUSTUM), stats() { }
+
+Culler::Culler(int keys) : Culler()
+{
+	keymin.resize(keys);
+	keymax.resize(keys);
+	inview.assign(keys, 1);
+	ranks.assign(keys, 0);
+	visibleparts.assign(keys, 0);
+	occluded.assign(keys, 0);
+	pending.assign(keys, 0);
+}
+
+/*
+	Function to create the occlusion queries and the cube drawn in place of a hidden key.
+*/
+void Culler::allocate()
+{
+	release();
+
+	queries.resize(inview.size());
+	glGenQueries((GLsizei)queries.size(), queries.data());
+
+	//unit cube from -1 to 1, as twelve triangles
+	const GLfloat corner[8][3] = { { -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 }, { -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 } };
+	const int face[36] = { 0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6, 0, 4, 5, 0, 5, 1, 3, 2, 6, 3, 6, 7, 0, 3, 7, 0, 7, 4, 1, 5, 6, 1, 6, 2 };
+	GLfloat vertices[36][3];
+	for (int i = 0; i < 36; i++)
+		for (int axis = 0; axis < 3; axis++)
+			vertices[i][axis] = corner[face[i]][axis];
+
+	glGenBuffers(1, &boxbuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, boxbuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	pending.assign(pending.size(), 0);
+	occluded.assign(occluded.size(), 0);
+}
+
+/*
+	Function to delete the occlusion queries and the cube.
+*/
+void Culler::release()
+{
+	if (!queries.empty()) glDeleteQueries((GLsizei)queries.size(), queries.data());
+	if (boxbuffer) glDeleteBuffers(1, &boxbuffer);
+	queries.clear();
+	boxbuffer = 0;
+}
+
+/*
+	Function to start a frame, taking the planes of the view frustum from the projection and camera matrices.
+*/
+void Culler::begin(mat4 Projection, mat4 View)
+{
+	stats = CullStats();
+	view = View;
+	camera = vec3(inverse(View)[3]);
+
+	//each plane is the last row of the matrix plus or minus one of the others
+	mat4 clip = Projection * View;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			vec4 plane;
+			for (int col = 0; col < 4; col++) plane[col] = clip[col][3] + (side == 0 ? clip[col][i] : -clip[col][i]);
+			planes[i * 2 + side] = plane / length(vec3(plane.x, plane.y, plane.z));
+		}
+	}
+
+	if (mode == CULL_OCCLUSION && queries.empty()) allocate();
+}
+
+/*
+	Function to test an axis-aligned box against the view frustum.
+	Tests the corner furthest along and furthest against each plane's normal.
+*/
+int Culler::testBox(vec3 min, vec3 max)
+{
+	vec3 centre = (min + max) * 0.5f, extent = (max - min) * 0.5f;
+	int result = INSIDE;
+
+	for (int i = 0; i < 6; i++)
+	{
+		float distance = planes[i].x * centre.x + planes[i].y * centre.y + planes[i].z * centre.z + planes[i].w;
+		float radius = fabs(planes[i].x) * extent.x + fabs(planes[i].y) * extent.y + fabs(planes[i].z) * extent.z;
+		if (distance + radius < 0.0f) return OUTSIDE;
+		if (distance - radius < 0.0f) result = INTERSECTS;
+	}
+
+	return result;
+}
+
+/*
+	Function to cull every part of every key, given each part's model matrix, and the centre and half size
+	of its box in its own space, in key order. Sets visible for every part, and remembers which keys are in view for drawKey.
+	Then ranks the keys front to back by the nearest point of their bounds in front of the camera.
+*/
+void Culler::cull(const mat4 model[], const vec3 centre[], const vec3 halfsize[], int objects, char visible[])
+{
+	int keys = (int)inview.size();
+	vector<vec3> partmin(objects), partmax(objects);
+
+	for (int key = 0; key < keys; key++)
+	{
+		int first = key * objects;
+
+		//world space bounds of each part and of the whole key
+		keymin[key] = vec3(INFINITY);
+		keymax[key] = vec3(-INFINITY);
+		for (int i = 0; i < objects; i++)
+		{
+			const mat4 &m = model[first + i];
+			const vec3 &h = halfsize[first + i];
+			vec3 middle = vec3(m * vec4(centre[first + i], 1.0f)), extent;
+			for (int row = 0; row < 3; row++) extent[row] = fabs(m[0][row]) * h.x + fabs(m[1][row]) * h.y + fabs(m[2][row]) * h.z;
+			partmin[i] = middle - extent;
+			partmax[i] = middle + extent;
+			keymin[key] = glm::min(keymin[key], partmin[i]);
+			keymax[key] = glm::max(keymax[key], partmax[i]);
+		}
+
+		stats.keys++;
+		stats.parts += objects;
+
+		int keytest = mode == CULL_NONE ? INSIDE : testBox(keymin[key], keymax[key]);
+		inview[key] = keytest != OUTSIDE;
+		if (keytest == OUTSIDE)
+		{
+			stats.frustumkeys++;
+			stats.frustumparts += objects;
+			occluded[key] = 0; //drawn when it comes back into view, rather than waiting on a query
+		}
+
+		//only a key on the edge of the view has its parts tested
+		visibleparts[key] = 0;
+		for (int i = 0; i < objects; i++)
+		{
+			visible[first + i] = keytest == INSIDE || (keytest == INTERSECTS && testBox(partmin[i], partmax[i]) != OUTSIDE);
+			if (visible[first + i]) visibleparts[key]++;
+			else if (keytest == INTERSECTS) stats.frustumparts++;
+		}
+	}
+
+	//rank the keys front to back by the view space depth of the nearest corner of their bounds
+	vector<float> nearest(keys);
+	for (int key = 0; key < keys; key++)
+	{
+		vec3 centre = (keymin[key] + keymax[key]) * 0.5f, extent = (keymax[key] - keymin[key]) * 0.5f;
+		float depth = -(view[0][2] * centre.x + view[1][2] * centre.y + view[2][2] * centre.z + view[3][2]);
+		nearest[key] = depth - (fabs(view[0][2]) * extent.x + fabs(view[1][2]) * extent.y + fabs(view[2][2]) * extent.z);
+	}
+
+	vector<int> order(keys);
+	for (int key = 0; key < keys; key++) order[key] = key;
+	std::sort(order.begin(), order.end(), [&](int a, int b) { return nearest[a] < nearest[b]; });
+	for (int i = 0; i < keys; i++) ranks[order[i]] = i;
+}
+
+/*
+	Function to return the place of a key counting front to back from the camera, 0 for the nearest, as of the last cull.
+*/
+int Culler::rank(int key)
+{
+	return ranks[key];
+}
+
+/*
+	Function to read the result of a key's last query, if the GPU has it ready.
+*/
+void Culler::readQuery(int key)
+{
+	if (!pending[key]) return;
+
+	GLuint available = 0;
+	glGetQueryObjectuiv(queries[key], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return;
+
+	GLuint samples = 0;
+	glGetQueryObjectuiv(queries[key], GL_QUERY_RESULT, &samples);
+	occluded[key] = samples == 0;
+	pending[key] = 0;
+}
+
+/*
+	Function to return whether a key should be drawn this frame: in view and, with occlusion culling, not hidden.
+	A key whose bounds hold the camera is always drawn, as its bounding box could be clipped away by the near plane.
+*/
+bool Culler::drawKey(int key)
+{
+	if (!inview[key]) return false;
+
+	if (mode == CULL_OCCLUSION)
+	{
+		readQuery(key);
+		bool inside = camera.x >= keymin[key].x && camera.y >= keymin[key].y && camera.z >= keymin[key].z &&
+			camera.x <= keymax[key].x && camera.y <= keymax[key].y && camera.z <= keymax[key].z;
+		if (inside) occluded[key] = 0;
+		if (occluded[key])
+		{
+			stats.occludedkeys++;
+			return false;
+		}
+	}
+
+	stats.drawnparts += visibleparts[key];
+	return true;
+}
+
+/*
+	Function to start the occlusion query of a key drawn this frame, if its last one has been read.
+*/
+void Culler::beginQuery(int key)
+{
+	if (mode != CULL_OCCLUSION || pending[key]) return;
+
+	glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[key]);
+	stats.queries++;
+}
+
+/*
+	Function to end the occlusion query started by beginQuery.
+*/
+void Culler::endQuery(int key)
+{
+	if (mode != CULL_OCCLUSION || pending[key]) return;
+
+	glEndQuery(GL_ANY_SAMPLES_PASSED);
+	pending[key] = 1;
+}
+
+/*
+	Function to draw the bounding box of every hidden key into its query, to find when it comes back into view.
+	Called after the rest of the scene, with its shader program current; modelID is its model matrix uniform.
+	Draws without writing colour or depth, and leaves the colour and normal attributes disabled.
+*/
+void Culler::queryHidden(GLint modelID)
+{
+	if (mode != CULL_OCCLUSION) return;
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glBindBuffer(GL_ARRAY_BUFFER, boxbuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glDisableVertexAttribArray(1);
+	glDisableVertexAttribArray(2);
+
+	for (int key = 0; key < (int)inview.size(); key++)
+	{
+		if (!inview[key] || !occluded[key] || pending[key]) continue;
+
+		vec3 centre = (keymin[key] + keymax[key]) * 0.5f, extent = (keymax[key] - keymin[key]) * 0.5f;
+		mat4 box = scale(translate(mat4(1.0f), centre), extent);
+		glUniformMatrix4fv(modelID, 1, GL_FALSE, &box[0][0]);
+
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[key]);
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		pending[key] = 1;
+		stats.queries++;
+	}
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthMask(GL_TRUE);
+}
@@ -0,0 +1,207 @@
+/*
+	FramePacer.cpp
+
+	Frame pacing governor, releasing each frame for presenting at an even target rate.
+	Waits for each deadline by sleeping until shortly before it, then spinning for the remainder,
+	as sleeps overshoot by up to a few milliseconds. The spin margin follows the measured overshoot,
+	up to a few milliseconds so a slow timer cannot turn into spinning for most of a frame.
+	On Windows the timer is raised to 1ms resolution while any pacer exists, as the default 15.6ms
+	would otherwise overshoot most deadlines.
+	Optionally caps the number of frames queued ahead of the GPU with fences, so input is not rendered
+	several frames late. Present-to-present intervals are timed after each buffer swap, to report the jitter.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <mmsystem.h> //timeBeginPeriod
+	#ifdef _MSC_VER
+		#pragma comment(lib, "winmm.lib")
+	#endif
+#endif
+#include "FramePacer.h"
+
+using namespace std;
+using namespace std::chrono;
+
+static const double MIN_SPIN = 0.0005, MAX_SPIN = 0.004; //range of the spin margin, in seconds
+
+namespace
+{
+	//raises the resolution of the system timer for the life of the program
+	struct TimerResolution
+	{
+#ifdef _WIN32
+		TimerResolution() { timeBeginPeriod(1); }
+		~TimerResolution() { timeEndPeriod(1); }
+#endif
+	};
+
+	/*
+		Function to raise the resolution of the system timer, the first time it is called.
+	*/
+	void raiseTimerResolution()
+	{
+		static TimerResolution resolution;
+		(void)resolution;
+	}
+}
+
+FramePacer::FramePacer() : spinmargin(0.002), nextinterval(0), rate(0), maxqueued(0), spin(true), frames(0), missed(0)
+{
+	raiseTimerResolution();
+}
+
+FramePacer::FramePacer(int rate, int maxqueued, bool spin) : FramePacer()
+{
+	this->maxqueued = maxqueued;
+	this->spin = spin;
+	setRate(rate);
+}
+
+/*
+	Function to set the target rate in frames per second, 0 for uncapped, and restart the statistics.
+*/
+void FramePacer::setRate(int rate)
+{
+	this->rate = rate;
+	deadline = steady_clock::now();
+	lastpresent = steady_clock::time_point(); //no frame presented yet
+	intervals.clear();
+	nextinterval = 0;
+	frames = missed = 0;
+}
+
+/*
+	Function to sleep until shortly before the given time, then spin until it.
+	Adjusts the spin margin towards twice the latest overshoot of the sleep.
+	Without spinning, only sleeps until the given time, for callers that need no better than the timer's precision.
+*/
+void FramePacer::sleepUntil(steady_clock::time_point until)
+{
+	if (!spin)
+	{
+		this_thread::sleep_until(until);
+		return;
+	}
+
+	steady_clock::time_point wake = until - duration_cast<steady_clock::duration>(duration<double>(spinmargin));
+	steady_clock::time_point now = steady_clock::now();
+
+	if (wake > now)
+	{
+		this_thread::sleep_until(wake);
+		double overshoot = duration<double>(steady_clock::now() - wake).count();
+		spinmargin += (2.0 * overshoot - spinmargin) * 0.1;
+		spinmargin = spinmargin < MIN_SPIN ? MIN_SPIN : (spinmargin > MAX_SPIN ? MAX_SPIN : spinmargin);
+	}
+
+	while (steady_clock::now() < until) { } //spin for the remainder
+}
+
+/*
+	Function to fence the frame just submitted and, if more than maxqueued frames are in flight,
+	wait for the GPU to finish the oldest.
+*/
+void FramePacer::limitQueue()
+{
+	if (maxqueued <= 0)
+	{
+		//cap turned off, let go of any fences left over
+		for (GLsync fence : fences) glDeleteSync(fence);
+		fences.clear();
+		return;
+	}
+
+	fences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	while ((int)fences.size() > maxqueued)
+	{
+		glClientWaitSync(fences.front(), GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); //wait at most one second
+		glDeleteSync(fences.front());
+		fences.pop_front();
+	}
+}
+
+/*
+	Function to hold the frame until its deadline, called once per frame just before it is presented.
+	A frame that misses its deadline by a whole period restarts the schedule from now,
+	rather than rushing the following frames to catch up.
+*/
+void FramePacer::wait()
+{
+	limitQueue();
+
+	if (rate > 0)
+	{
+		duration<double> period(1.0 / rate);
+		deadline += duration_cast<steady_clock::duration>(period);
+
+		steady_clock::time_point now = steady_clock::now();
+		if (now - deadline >= period) //fallen behind
+		{
+			missed++;
+			deadline = now;
+		}
+		else sleepUntil(deadline);
+	}
+
+	frames++;
+}
+
+/*
+	Function to record that the last frame has been presented, called once per frame after the buffers are swapped,
+	such as at the start of drawing the next frame.
+*/
+void FramePacer::presented()
+{
+	steady_clock::time_point present = steady_clock::now();
+	double interval = duration<double>(present - lastpresent).count();
+	bool first = lastpresent == steady_clock::time_point();
+	lastpresent = present;
+	if (first) return; //the first present has no interval before it
+
+	if ((int)intervals.size() < HISTORY) intervals.push_back(interval);
+	else intervals[nextinterval] = interval;
+	nextinterval = (nextinterval + 1) % HISTORY;
+}
+
+/*
+	Function to return the mean present-to-present interval, in seconds.
+*/
+double FramePacer::meanInterval()
+{
+	if (intervals.empty()) return 0.0;
+
+	double sum = 0.0;
+	for (double interval : intervals) sum += interval;
+	return sum / intervals.size();
+}
+
+/*
+	Function to return the jitter, the standard deviation of the present-to-present interval, in seconds.
+*/
+double FramePacer::jitter()
+{
+	if (intervals.empty()) return 0.0;
+
+	double mean = meanInterval(), sum = 0.0;
+	for (double interval : intervals) sum += (interval - mean) * (interval - mean);
+	return sqrt(sum / intervals.size());
+}
+
+/*
+	Function to return the longest recent present-to-present interval, in seconds.
+*/
+double FramePacer::worstInterval()
+{
+	double worst = 0.0;
+	for (double interval : intervals) worst = interval > worst ? interval : worst;
+	return worst;
+}
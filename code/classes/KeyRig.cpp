@@ -0,0 +1,179 @@
+/*
+	KeyRig.cpp
+
+	Data-driven rig of the objects within a key model.
+	Each part is placed by an offset from its parent, and the parts are kept in an array sorted so that
+	every parent comes before its children, so one pass places them all. Each part also has a motion type;
+	parts are grouped by type, and each group is posed by a function specialised for that type at compile time,
+	so posing runs a tight loop per type with no branching on the object.
+	Offsets and travels are taken from the piano's dimensions once, when the rig is built,
+	so the posing functions hold no dimensions of their own.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <glm/glm.hpp> //glm core
+#include "Shape.h"
+#include "Cuboid.h"
+#include "Tetrahedron.h"
+#include "Cylinder.h"
+#include "Piano.h"
+#include "Transform.h"
+#include "ActionClip.h"
+#include "KeyRig.h"
+
+using namespace std;
+using namespace glm;
+
+namespace
+{
+	//values shared by every part of a key as it is posed
+	struct RigContext
+	{
+		vec3 pivotpoint; //point of pivot of the key and lever
+		ActionSample action; //sampled key press
+	};
+
+	/*
+		Function to pose one part of the given motion type, as a rotation around a pivot after a translation.
+	*/
+	template <MotionType M>
+	void poseMotion(const RigPart &part, vec3 position, const RigContext &context, PartPoses &poses, int index);
+
+	//rotates around the point of pivot by the sampled key angle
+	template <>
+	void poseMotion<MOTION_KEY>(const RigPart &part, vec3 position, const RigContext &context, PartPoses &poses, int index)
+	{
+		poses.set(index, context.action.key, part.axis, context.pivotpoint, position);
+	}
+
+	//rotates around the point of pivot by a fixed angle
+	template <>
+	void poseMotion<MOTION_FIXED>(const RigPart &part, vec3 position, const RigContext &context, PartPoses &poses, int index)
+	{
+		poses.set(index, part.angle, part.axis, context.pivotpoint, position);
+	}
+
+	//lifts towards the wire by the sampled fraction of the hammer's travel
+	template <>
+	void poseMotion<MOTION_HAMMER>(const RigPart &part, vec3 position, const RigContext &context, PartPoses &poses, int index)
+	{
+		poses.set(index, 0.0f, part.axis, position, position + vec3(0.0f, context.action.hammer * part.travel, 0.0f));
+	}
+
+	//lifts away from the wire by the sampled fraction of the damper's travel
+	template <>
+	void poseMotion<MOTION_DAMPER>(const RigPart &part, vec3 position, const RigContext &context, PartPoses &poses, int index)
+	{
+		poses.set(index, 0.0f, part.axis, position, position + vec3(0.0f, context.action.damper * part.travel, 0.0f));
+	}
+
+	//rotates around its own position to lie horizontally, then is vibrated by the sampled displacement
+	template <>
+	void poseMotion<MOTION_WIRE>(const RigPart &part, vec3 position, const RigContext &context, PartPoses &poses, int index)
+	{
+		poses.set(index, part.angle, part.axis, position, position + part.motionoffset + vec3(context.action.wire, 0.0f, 0.0f));
+	}
+
+	/*
+		Function to pose every part of one motion type.
+	*/
+	template <MotionType M>
+	void poseParts(const vector<RigPart> &parts, const vector<int> &indices, const vec3 position[], const RigContext &context, PartPoses &poses, int first)
+	{
+		for (int i : indices) poseMotion<M>(parts[i], position[i], context, poses, first + parts[i].object);
+	}
+}
+
+KeyRig::KeyRig() : pivotpart(0) { }
+
+//dimensions of the action not taken from the piano's shapes
+static const GLfloat PIVOT_INSET = 0.8f; //distance along the key from the hammerarm back to the pivot beneath it
+static const GLfloat DAMPER_SPACING = 1.0f; //distance along the key from the hammer to the damperarm
+static const GLfloat DAMPER_CLEARANCE = 0.31f; //distance the damper lifts beyond the hammer's travel, to clear the wire
+static const GLfloat PIVOT_ANGLE = 65.0f; //turn of the pivot tetrahedron, to stand side on
+static const GLfloat WIRE_ANGLE = 90.0f; //turn of the wire, to lie parallel to the x-axis
+static const GLfloat WIRE_HEIGHT = 1.5f; //height of the wire above the damper, before its turn
+static const GLfloat WIRE_DEPTH = 0.05f; //offset of the wire across the key
+
+/*
+	Constructor to build the rig of the given piano key model, with the key resting at the given height:
+	The key sits at the initial position, with the lever at its end and the pivot beneath the lever,
+	The hammerarm and hammer stand above the pivot, the damperarm and damper to their side,
+	The wire is placed from the damper, lying across the top of the action
+*/
+KeyRig::KeyRig(Piano &piano, GLfloat restheight) : KeyRig()
+{
+	//the wire centre is level with the top of the damperarm, above the resting key;
+	//the hammer rises from rest to the wire, and the damper further to clear it
+	GLfloat wirecentre = restheight + piano.key.height + piano.damperarm.height;
+	GLfloat hammertravel = wirecentre - piano.damperarm.height / 2;
+	GLfloat dampertravel = hammertravel + DAMPER_CLEARANCE;
+
+	add({ 0, -1, vec3(0.0f), MOTION_KEY, 0.0f, vec3(0, 0, 1), vec3(0.0f), 0.0f });
+	add({ 1, 0, vec3(piano.key.width / 2 + piano.lever.width / 2, piano.key.height / 2 - piano.lever.height / 2, 0), MOTION_KEY, 0.0f, vec3(0, 0, 1), vec3(0.0f), 0.0f });
+	add({ 2, 1, vec3(-PIVOT_INSET, -piano.pivot.height / 2 - piano.lever.height / 2, 0.0), MOTION_FIXED, PIVOT_ANGLE, vec3(0, 1, 0), vec3(0.0f), 0.0f }); //side on
+	add({ 3, 2, vec3(PIVOT_INSET, piano.pivot.height / 2 + piano.lever.height + piano.hammerarm.height / 2, 0.0), MOTION_HAMMER, 0.0f, vec3(0, 0, 1), vec3(0.0f), hammertravel });
+	add({ 4, 3, vec3(0.0, piano.hammerarm.height / 2 + piano.hammer.height / 2, 0.0), MOTION_HAMMER, 0.0f, vec3(0, 0, 1), vec3(0.0f), hammertravel });
+	add({ 5, 4, vec3(DAMPER_SPACING, -piano.hammer.height / 2 - piano.hammerarm.height + piano.damperarm.height / 2, 0.0), MOTION_DAMPER, 0.0f, vec3(0, 0, 1), vec3(0.0f), dampertravel });
+	add({ 6, 5, vec3(0.0, piano.damperarm.height / 2 + piano.damper.height / 2, 0.0), MOTION_DAMPER, 0.0f, vec3(0, 0, 1), vec3(0.0f), dampertravel });
+	add({ 7, 6, vec3(0.0f), MOTION_WIRE, WIRE_ANGLE, vec3(0, 0, 1), vec3(-piano.damper.height / 2 - piano.wire.width / 2, WIRE_HEIGHT, WIRE_DEPTH), 0.0f }); //parallel to the x-axis
+
+	//the key and lever pivot on top of the pivot tetrahedron
+	pivotpart = 2;
+	pivotoffset = vec3(0.0, piano.pivot.height / 2 + piano.lever.height / 2, 0.0);
+}
+
+/*
+	Function to add a part, which must come after its parent.
+*/
+void KeyRig::add(RigPart part)
+{
+	if (part.parent >= (int)parts.size()) throw runtime_error("KeyRig: part " + to_string(parts.size()) + " placed from a later part");
+	if (parts.size() == Piano::OBJECTS) throw runtime_error("KeyRig: more parts than objects in the model");
+
+	motions[part.motion].push_back((int)parts.size());
+	parts.push_back(part);
+}
+
+/*
+	Function to return the number of parts in the rig.
+*/
+int KeyRig::size()
+{
+	return (int)parts.size();
+}
+
+/*
+	Function to position each part, starting from the key at the initial position.
+	Fills position with one entry per part, in the order of Piano::getObjectByIndex, and sets the point of pivot.
+*/
+void KeyRig::place(vec3 initial, vec3 position[], vec3 &pivotpoint)
+{
+	vec3 placed[Piano::OBJECTS];
+	for (int i = 0; i < (int)parts.size(); i++)
+	{
+		placed[i] = (parts[i].parent < 0 ? initial : placed[parts[i].parent]) + parts[i].offset;
+		position[parts[i].object] = placed[i];
+	}
+	pivotpoint = placed[pivotpart] + pivotoffset;
+}
+
+/*
+	Function to pose each part for batchTransform, writing them to poses from index first onwards
+	in the order of Piano::getObjectByIndex.
+*/
+void KeyRig::pose(vec3 initial, ActionSample action, PartPoses &poses, int first)
+{
+	vec3 placed[Piano::OBJECTS];
+	for (int i = 0; i < (int)parts.size(); i++) placed[i] = (parts[i].parent < 0 ? initial : placed[parts[i].parent]) + parts[i].offset;
+
+	RigContext context = { placed[pivotpart] + pivotoffset, action };
+	poseParts<MOTION_KEY>(parts, motions[MOTION_KEY], placed, context, poses, first);
+	poseParts<MOTION_FIXED>(parts, motions[MOTION_FIXED], placed, context, poses, first);
+	poseParts<MOTION_HAMMER>(parts, motions[MOTION_HAMMER], placed, context, poses, first);
+	poseParts<MOTION_DAMPER>(parts, motions[MOTION_DAMPER], placed, context, poses, first);
+	poseParts<MOTION_WIRE>(parts, motions[MOTION_WIRE], placed, context, poses, first);
+}
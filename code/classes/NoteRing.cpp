@@ -0,0 +1,249 @@
+/*
+	NoteRing.cpp
+
+	Shared memory ring of note events between an external producer process and the piano.
+	POSIX shared memory on Linux and macOS, a named file mapping on Windows.
+	The producer is the only writer of head and the consumer the only writer of tail,
+	so each end publishes with a release store and reads the other end's position with an acquire load,
+	and no lock is needed. Each end keeps its own copy of the other's position and only re-reads it
+	when the ring looks full or empty, so the two cache lines are not passed back and forth every event.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <new>
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <time.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+#include "NoteRing.h"
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "ring positions must be lock-free to be shared between processes");
+
+NoteRing::NoteRing() : memory(nullptr), owner(false)
+#ifdef _WIN32
+	, handle(nullptr)
+#else
+	, fd(-1)
+#endif
+{ }
+
+NoteRing::~NoteRing()
+{
+	close();
+}
+
+/*
+	Function to map the named shared memory, creating it if specified.
+	Returns whether the memory was mapped.
+*/
+bool NoteRing::map(const char* name, bool create)
+{
+	close();
+	this->name = name;
+
+#ifdef _WIN32
+	std::string mapping = std::string("Local\\") + (name[0] == '/' ? name + 1 : name);
+	if (create) handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(NoteRingMemory), mapping.c_str());
+	else handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mapping.c_str());
+	if (handle == nullptr) return false;
+
+	memory = (NoteRingMemory*)MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(NoteRingMemory));
+#else
+	fd = shm_open(name, create ? O_CREAT | O_RDWR : O_RDWR, 0600);
+	if (fd < 0) return false;
+
+	struct stat info;
+	if (create && ftruncate(fd, sizeof(NoteRingMemory)) != 0) { close(); return false; }
+	if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(NoteRingMemory)) { close(); return false; }
+
+	void *address = mmap(nullptr, sizeof(NoteRingMemory), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	memory = address == MAP_FAILED ? nullptr : (NoteRingMemory*)address;
+#endif
+
+	if (memory == nullptr) { close(); return false; }
+	owner = create;
+	return true;
+}
+
+/*
+	Function to return whether the ring is mapped.
+*/
+bool NoteRing::isOpen()
+{
+	return memory != nullptr;
+}
+
+/*
+	Function to unmap the ring. The creating end also removes the name,
+	so a producer still attached keeps its mapping but a new one cannot open it.
+*/
+void NoteRing::close()
+{
+#ifdef _WIN32
+	if (memory != nullptr) UnmapViewOfFile(memory);
+	if (handle != nullptr) CloseHandle(handle);
+	handle = nullptr;
+#else
+	if (memory != nullptr) munmap(memory, sizeof(NoteRingMemory));
+	if (fd >= 0) ::close(fd);
+	if (fd >= 0 && owner) shm_unlink(name.c_str());
+	fd = -1;
+#endif
+	memory = nullptr;
+	owner = false;
+}
+
+/*
+	Function to return the monotonic time in nanoseconds.
+	Read through the vDSO on Linux and QueryPerformanceCounter on Windows, neither enters the kernel,
+	and both are shared by every process on the machine, so timestamps can be compared between the ends.
+*/
+uint64_t NoteRing::now()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = []() { LARGE_INTEGER f; QueryPerformanceFrequency(&f); return f; }();
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull / frequency.QuadPart;
+#else
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000ull + time.tv_nsec;
+#endif
+}
+
+NoteProducer::NoteProducer() : cachedtail(0), sent(0), dropped(0) { }
+
+/*
+	Function to open a ring created by the piano.
+	Fails if the piano is not running, or the memory was not initialised as a ring of this version.
+*/
+bool NoteProducer::open(const char* name)
+{
+	if (!map(name, false)) return false;
+
+	if (memory->magic.load(std::memory_order_acquire) != NoteRingMemory::MAGIC || memory->version != NoteRingMemory::VERSION)
+	{
+		close();
+		return false;
+	}
+
+	cachedtail = memory->tail.load(std::memory_order_acquire);
+	return true;
+}
+
+/*
+	Function to push an event onto the ring.
+	Never waits; returns false and counts the event as dropped if the ring is full.
+*/
+bool NoteProducer::push(NoteEvent event)
+{
+	uint64_t head = memory->head.load(std::memory_order_relaxed);
+
+	if (head - cachedtail >= NoteRingMemory::CAPACITY)
+	{
+		cachedtail = memory->tail.load(std::memory_order_acquire);
+		if (head - cachedtail >= NoteRingMemory::CAPACITY)
+		{
+			dropped++;
+			return false;
+		}
+	}
+
+	memory->events[head & (NoteRingMemory::CAPACITY - 1)] = event;
+	memory->head.store(head + 1, std::memory_order_release); //publish the event
+	sent++;
+	return true;
+}
+
+/*
+	Function to push a note played (velocity 1 to 127) or released (velocity 0), timestamped now.
+*/
+bool NoteProducer::push(int note, int velocity)
+{
+	NoteEvent event = { now(), note, velocity };
+	return push(event);
+}
+
+NoteConsumer::NoteConsumer() : cachedhead(0)
+{
+	resetStats();
+}
+
+/*
+	Function to create the ring, or reattach to one left by an earlier run, discarding any events in it.
+*/
+bool NoteConsumer::create(const char* name)
+{
+	if (!map(name, true)) return false;
+
+	if (memory->magic.load(std::memory_order_acquire) != NoteRingMemory::MAGIC || memory->version != NoteRingMemory::VERSION)
+	{
+		//new memory is zeroed, initialise the header then mark the ring ready
+		new (memory) NoteRingMemory;
+		memory->version = NoteRingMemory::VERSION;
+		memory->capacity = NoteRingMemory::CAPACITY;
+		memory->head.store(0, std::memory_order_relaxed);
+		memory->tail.store(0, std::memory_order_relaxed);
+		memory->magic.store(NoteRingMemory::MAGIC, std::memory_order_release);
+	}
+
+	cachedhead = memory->head.load(std::memory_order_acquire);
+	memory->tail.store(cachedhead, std::memory_order_release);
+	return true;
+}
+
+/*
+	Function to move up to max waiting events into the given array, oldest first.
+	Returns the number of events drained, and adds their latency to the statistics.
+*/
+int NoteConsumer::drain(NoteEvent events[], int max)
+{
+	if (memory == nullptr) return 0;
+
+	uint64_t tail = memory->tail.load(std::memory_order_relaxed);
+	if (cachedhead - tail < (uint64_t)max) cachedhead = memory->head.load(std::memory_order_acquire); //more may have arrived
+
+	int count = cachedhead - tail < (uint64_t)max ? (int)(cachedhead - tail) : max;
+	if (count == 0) return 0;
+
+	for (int i = 0; i < count; i++) events[i] = memory->events[(tail + i) & (NoteRingMemory::CAPACITY - 1)];
+	memory->tail.store(tail + count, std::memory_order_release); //hand the slots back to the producer
+
+	uint64_t time = now();
+	for (int i = 0; i < count; i++)
+	{
+		double latency = time > events[i].time ? (time - events[i].time) * 1e-9 : 0.0;
+		latencysum += latency;
+		latencymax = latency > latencymax ? latency : latencymax;
+	}
+	received += count;
+
+	return count;
+}
+
+/*
+	Function to return the mean time from event to drain, in seconds.
+*/
+double NoteConsumer::meanLatency()
+{
+	return received > 0 ? latencysum / received : 0.0;
+}
+
+/*
+	Function to reset the event count and latency statistics.
+*/
+void NoteConsumer::resetStats()
+{
+	received = 0;
+	latencysum = latencymax = 0.0;
+}
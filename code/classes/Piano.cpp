@@ -46,8 +46,9 @@ Piano::Piano(std::string type)
 
 /*
 	Function to return the object shape, given the index within the model.
+	Returned by reference so callers can read the shape data without copying it.
 */
-Shape Piano::getObjectByIndex(int index)
+Shape& Piano::getObjectByIndex(int index)
 {
 	switch (index)
 	{
@@ -61,7 +62,8 @@ Shape Piano::getObjectByIndex(int index)
 		case 7: return wire; break;
 	}
 
-	return Shape();
+	static Shape none; //empty shape for an unknown index
+	return none;
 }
 
 /*
@@ -79,4 +81,16 @@ int Piano::getIndexByObject(std::string object)
 	else if(object == "wire") return 7;
 
 	return NULL;
-}
\ No newline at end of file
+}
+
+/*
+	Function to return the shape type, given the object index.
+*/
+std::string Piano::getObjectNameByIndex(int index)
+{
+	const char* names[OBJECTS] = { "key", "lever", "pivot", "hammerarm", "hammer", "damperarm", "damper", "wire" };
+
+	if (index >= 0 && index < OBJECTS) return names[index];
+
+	return "";
+}
@@ -0,0 +1,217 @@
+/*
+	Picker.cpp
+
+	Picking of the part under a ray, through a bounding volume hierarchy over the bounding boxes of every part.
+	Each part is bounded by the box around its shape's vertices, and the hierarchy is kept in object space,
+	before the rotation of the whole object, so turning the object leaves it untouched.
+	The tree is built once, splitting the parts at the median along their widest axis;
+	as keys move only the leaves that changed are refitted, then each node above them once, children before parents.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <glm/glm.hpp> //glm core
+#include "Picker.h"
+
+using namespace std;
+using namespace glm;
+
+Picker::Picker() : refitted(0) { }
+
+/*
+	Function to calculate the object space bounds of a part, the box around its transformed shape box.
+*/
+void Picker::partBounds(int part, vec3 &min, vec3 &max)
+{
+	const mat4 &m = transforms[part];
+	vec3 centre = vec3(m * vec4(centres[part], 1.0f));
+	vec3 extent;
+	for (int row = 0; row < 3; row++)
+	{
+		extent[row] = fabs(m[0][row]) * halfsizes[part].x + fabs(m[1][row]) * halfsizes[part].y + fabs(m[2][row]) * halfsizes[part].z;
+	}
+	min = centre - extent;
+	max = centre + extent;
+}
+
+/*
+	Function to build the subtree over parts [begin, end) beneath the given parent, returning its node.
+*/
+int Picker::build(vector<int> &parts, int begin, int end, int parent)
+{
+	int index = (int)nodes.size();
+	nodes.push_back(Node());
+	Node node = { vec3(INFINITY), vec3(-INFINITY), -1, -1, parent, -1, false };
+
+	if (end - begin == 1)
+	{
+		node.part = parts[begin];
+		partBounds(node.part, node.min, node.max);
+		leaves[node.part] = index;
+		nodes[index] = node;
+		return index;
+	}
+
+	//split at the median centre along the axis the centres spread furthest over
+	vec3 low = vec3(INFINITY), high = vec3(-INFINITY);
+	for (int i = begin; i < end; i++)
+	{
+		vec3 centre = vec3(transforms[parts[i]][3]);
+		low = glm::min(low, centre);
+		high = glm::max(high, centre);
+	}
+	vec3 spread = high - low;
+	int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+	int middle = (begin + end) / 2;
+	nth_element(parts.begin() + begin, parts.begin() + middle, parts.begin() + end, [&](int a, int b)
+	{
+		return transforms[a][3][axis] < transforms[b][3][axis];
+	});
+
+	node.left = build(parts, begin, middle, index);
+	node.right = build(parts, middle, end, index);
+	node.min = glm::min(nodes[node.left].min, nodes[node.right].min);
+	node.max = glm::max(nodes[node.left].max, nodes[node.right].max);
+	nodes[index] = node;
+	return index;
+}
+
+/*
+	Function to build the hierarchy over the given number of parts,
+	given each part's transform into object space, and the centre and half size of its box in its own space.
+*/
+void Picker::build(const mat4 transform[], const vec3 centre[], const vec3 halfsize[], int parts)
+{
+	transforms.assign(transform, transform + parts);
+	centres.assign(centre, centre + parts);
+	halfsizes.assign(halfsize, halfsize + parts);
+	leaves.assign(parts, -1);
+	nodes.clear();
+	nodes.reserve(2 * parts);
+
+	vector<int> order(parts);
+	for (int i = 0; i < parts; i++) order[i] = i;
+	if (parts > 0) build(order, 0, parts, -1);
+}
+
+/*
+	Function to refit the hierarchy to new part transforms, touching only the parts that moved and the nodes above them.
+*/
+void Picker::update(const mat4 transform[])
+{
+	refitted = 0;
+	dirty.clear();
+
+	for (int part = 0; part < (int)transforms.size(); part++)
+	{
+		if (transforms[part] == transform[part]) continue; //part has not moved
+		transforms[part] = transform[part];
+
+		int index = leaves[part];
+		partBounds(part, nodes[index].min, nodes[index].max);
+		refitted++;
+
+		//mark the nodes above, stopping at one already marked by an earlier part
+		for (index = nodes[index].parent; index >= 0 && !nodes[index].dirty; index = nodes[index].parent)
+		{
+			nodes[index].dirty = true;
+			dirty.push_back(index);
+		}
+	}
+
+	//parents are stored before their children, so refitting in reverse order finishes the children first
+	sort(dirty.begin(), dirty.end(), greater<int>());
+	for (int index : dirty)
+	{
+		Node &node = nodes[index];
+		node.min = glm::min(nodes[node.left].min, nodes[node.right].min);
+		node.max = glm::max(nodes[node.left].max, nodes[node.right].max);
+		node.dirty = false;
+	}
+	refitted += (int)dirty.size();
+}
+
+/*
+	Function to test a ray against an axis-aligned box by the slab method.
+	Takes the reciprocal of the ray direction, and returns the entry distance along the ray if hit.
+*/
+bool Picker::hitBox(vec3 origin, vec3 inverse, vec3 min, vec3 max, float &distance)
+{
+	vec3 t0 = (min - origin) * inverse;
+	vec3 t1 = (max - origin) * inverse;
+	vec3 tnear = glm::min(t0, t1), tfar = glm::max(t0, t1);
+	float enter = std::max(std::max(tnear.x, tnear.y), std::max(tnear.z, 0.0f));
+	float exit = std::min(std::min(tfar.x, tfar.y), tfar.z);
+	distance = enter;
+	return enter <= exit;
+}
+
+/*
+	Function to find the nearest part hit by a ray, given in object space with a unit direction.
+	Visits the nearer child first and skips any node further than the nearest hit so far.
+	Each candidate leaf is tested against the part's own box, in the part's space.
+	Returns the part, or -1 if none is hit, and sets the distance along the ray.
+*/
+int Picker::pick(vec3 origin, vec3 direction, float &distance)
+{
+	int nearest = -1;
+	distance = INFINITY;
+	if (nodes.empty()) return nearest;
+
+	vec3 inverse = 1.0f / direction;
+	int stack[64];
+	int top = 0;
+	float enter;
+	if (hitBox(origin, inverse, nodes[0].min, nodes[0].max, enter)) stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node &node = nodes[stack[--top]];
+		if (!hitBox(origin, inverse, node.min, node.max, enter) || enter > distance) continue;
+
+		if (node.part >= 0)
+		{
+			//parts are rigid, so the ray moves into the part's space by the transposed rotation, keeping its length
+			const mat4 &m = transforms[node.part];
+			mat3 rotation = transpose(mat3(m));
+			vec3 localorigin = rotation * (origin - vec3(m[3]));
+			vec3 localdirection = rotation * direction;
+			vec3 min = centres[node.part] - halfsizes[node.part], max = centres[node.part] + halfsizes[node.part];
+			if (hitBox(localorigin, 1.0f / localdirection, min, max, enter) && enter < distance)
+			{
+				distance = enter;
+				nearest = node.part;
+			}
+			continue;
+		}
+
+		//push the further child first, so the nearer is visited first
+		float leftenter, rightenter;
+		bool left = hitBox(origin, inverse, nodes[node.left].min, nodes[node.left].max, leftenter);
+		bool right = hitBox(origin, inverse, nodes[node.right].min, nodes[node.right].max, rightenter);
+		if (left && right && leftenter < rightenter)
+		{
+			stack[top++] = node.right;
+			stack[top++] = node.left;
+		}
+		else
+		{
+			if (left) stack[top++] = node.left;
+			if (right) stack[top++] = node.right;
+		}
+	}
+
+	return nearest;
+}
+
+/*
+	Function to return the number of parts in the hierarchy.
+*/
+int Picker::size()
+{
+	return (int)leaves.size();
+}
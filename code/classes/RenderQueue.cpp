@@ -0,0 +1,126 @@
+/*
+	RenderQueue.cpp
+
+	Queue of draw calls, sorted by a packed 64-bit key before drawing so that state changes are grouped.
+	The key holds, from the highest bits, the render pass, shader program, group, mesh and material,
+	then the depth from the camera so that draws sharing all state run front to back.
+	Each key carries the index of its draw as the payload, and is sorted with a stable least significant digit
+	radix sort, a byte at a time. A byte that is the same in every key needs no pass, so fields that do not vary
+	in a frame cost nothing beyond counting them.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <cstdint>
+#include "RenderQueue.h"
+
+using namespace std;
+
+RenderQueue::RenderQueue() : stats() { }
+
+/*
+	Function to pack a sort key from the pass (4 bits), program (8 bits), group (16 bits), mesh (8 bits) and material (8 bits),
+	and the depth quantised to 20 bits over [0, range]. Each field is cut to its width, so callers must keep within it.
+*/
+uint64_t RenderQueue::makeKey(int pass, int program, int group, int mesh, int material, float depth, float range)
+{
+	float fraction = depth / range;
+	fraction = fraction < 0.0f ? 0.0f : (fraction > 1.0f ? 1.0f : fraction);
+
+	return ((uint64_t)(pass & ((1 << PASS_BITS) - 1)) << PASS_SHIFT) | ((uint64_t)(program & ((1 << PROGRAM_BITS) - 1)) << PROGRAM_SHIFT) |
+		((uint64_t)(group & ((1 << GROUP_BITS) - 1)) << GROUP_SHIFT) | ((uint64_t)(mesh & ((1 << MESH_BITS) - 1)) << MESH_SHIFT) |
+		((uint64_t)(material & ((1 << MATERIAL_BITS) - 1)) << MATERIAL_SHIFT) | (uint64_t)(fraction * DEPTH_MAX);
+}
+
+/*
+	Function to unpack a field of the given shift and width in bits from a sort key.
+*/
+int RenderQueue::field(uint64_t key, int shift, int bits)
+{
+	return (int)((key >> shift) & ((1ull << bits) - 1));
+}
+
+/*
+	Function to empty the queue, keeping its memory for the next frame.
+*/
+void RenderQueue::clear()
+{
+	keys.clear();
+	order.clear();
+	items.clear();
+}
+
+/*
+	Function to add a draw with its sort key.
+*/
+void RenderQueue::push(uint64_t key, DrawItem draw)
+{
+	order.push_back((int)items.size());
+	keys.push_back(key);
+	items.push_back(draw);
+}
+
+/*
+	Function to sort the queue by key, keeping draws with equal keys in the order they were pushed.
+	Counts every byte of every key in one pass first, then only sorts on the bytes that differ between keys.
+*/
+void RenderQueue::sort()
+{
+	int count = (int)keys.size();
+	sortedkeys.resize(count);
+	sortedorder.resize(count);
+	stats.sortpasses = 0;
+
+	int histogram[8][256] = {};
+	for (uint64_t key : keys)
+		for (int digit = 0; digit < 8; digit++)
+			histogram[digit][(key >> (digit * 8)) & 0xFF]++;
+
+	for (int digit = 0; digit < 8; digit++)
+	{
+		if (count == 0 || histogram[digit][(keys[0] >> (digit * 8)) & 0xFF] == count) continue; //every key shares this byte
+
+		//start of each bucket
+		int offset[256];
+		int total = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			offset[bucket] = total;
+			total += histogram[digit][bucket];
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			int slot = offset[(keys[i] >> (digit * 8)) & 0xFF]++;
+			sortedkeys[slot] = keys[i];
+			sortedorder[slot] = order[i];
+		}
+		keys.swap(sortedkeys);
+		order.swap(sortedorder);
+		stats.sortpasses++;
+	}
+}
+
+/*
+	Function to return the number of draws in the queue.
+*/
+int RenderQueue::size()
+{
+	return (int)keys.size();
+}
+
+/*
+	Function to return the key of the i-th draw, in sorted order once sorted.
+*/
+uint64_t RenderQueue::key(int i)
+{
+	return keys[i];
+}
+
+/*
+	Function to return the i-th draw, in sorted order once sorted.
+*/
+const DrawItem& RenderQueue::item(int i)
+{
+	return items[order[i]];
+}
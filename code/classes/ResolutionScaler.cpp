@@ -0,0 +1,185 @@
+/*
+	ResolutionScaler.cpp
+
+	Dynamic resolution scaling to hold a frame time budget.
+	When enabled, the scene is rendered into an offscreen framebuffer at a fraction of the window resolution,
+	then stretched onto the window. A controller adjusts the fraction each frame from the time spent rendering it,
+	the CPU time up to presenting plus the GPU time from a timer query, so time spent waiting for the frame's
+	deadline does not count: it backs off in proportion to how far over budget the frame is, at most once per
+	settling period, and creeps back up only while clearly within budget.
+	Timer results are read a few frames late and only when available, so the CPU never waits on the GPU.
+	The offscreen target is allocated at the full window size and only a corner of it is used,
+	so changing the scale never reallocates it.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <cmath>
+#include "ResolutionScaler.h"
+
+ResolutionScaler::ResolutionScaler()
+	: framebuffer(0), colour(0), depth(0), allocated_width(0), allocated_height(0), settling(0),
+	timers(), timing(), nexttimer(0), framestart(0.0), gputime(0.0), enabled(false), target(1.0 / 60.0), frametime(1.0 / 60.0), scale(1.0f), window_width(0), window_height(0), width(0), height(0) { }
+
+ResolutionScaler::ResolutionScaler(int window_width, int window_height, double target) : ResolutionScaler()
+{
+	this->target = target;
+	this->frametime = target;
+	resize(window_width, window_height);
+}
+
+/*
+	Function to set the size of the window framebuffer, called whenever the window is resized.
+*/
+void ResolutionScaler::resize(int w, int h)
+{
+	window_width = w;
+	window_height = h;
+	width = (int)(w * scale);
+	height = (int)(h * scale);
+}
+
+/*
+	Function to start timing a frame, called before any of it is rendered.
+	A query whose result is still not back after every other has been used leaves the frame untimed on the GPU.
+*/
+void ResolutionScaler::beginFrame()
+{
+	if (!timers[0]) glGenQueries(TIMERS, timers);
+
+	framestart = glfwGetTime();
+	readTimers();
+	if (!timing[nexttimer]) glBeginQuery(GL_TIME_ELAPSED, timers[nexttimer]);
+}
+
+/*
+	Function to finish timing a frame, called after it is rendered and before waiting to present it,
+	then adjust the scale from the CPU time and the latest GPU time.
+	The two are added as if they did not overlap, so the budget keeps some headroom.
+*/
+void ResolutionScaler::endFrame()
+{
+	if (!timing[nexttimer])
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		timing[nexttimer] = true;
+		nexttimer = (nexttimer + 1) % TIMERS;
+	}
+
+	readTimers();
+	update(glfwGetTime() - framestart + gputime);
+}
+
+/*
+	Function to read back the timer queries the GPU has finished, oldest first.
+*/
+void ResolutionScaler::readTimers()
+{
+	for (int i = 0; i < TIMERS; i++)
+	{
+		int timer = (nexttimer + i) % TIMERS;
+		if (!timing[timer]) continue;
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(timers[timer], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break; //later queries finish after this one
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(timers[timer], GL_QUERY_RESULT, &elapsed);
+		gputime = elapsed * 1e-9;
+		timing[timer] = false;
+	}
+}
+
+/*
+	Function to take the time spent rendering the last frame and, when enabled, adjust the scale to match.
+	Rendering time follows the number of pixels, the square of the scale, so an over budget frame
+	scales down by the square root of the ratio. Clearly within budget the scale grows slowly back towards full size.
+*/
+void ResolutionScaler::update(double last)
+{
+	frametime += (last - frametime) * 0.1; //smooth out single slow frames
+	if (!enabled) return;
+
+	if (settling > 0) //the last back off is still settling
+	{
+		settling--;
+	}
+	else if (frametime > target) //over budget, back off
+	{
+		scale *= (GLfloat)sqrt(target / frametime);
+		settling = SETTLE_FRAMES;
+	}
+	else if (frametime < target * 0.85) //clearly within budget, try a little more resolution
+	{
+		scale += 0.005f;
+	}
+
+	GLfloat minimum = MIN_PERCENT / 100.0f;
+	scale = scale < minimum ? minimum : (scale > 1.0f ? 1.0f : scale);
+	width = (int)(window_width * scale);
+	height = (int)(window_height * scale);
+}
+
+/*
+	Function to create the offscreen colour and depth targets at the window size.
+*/
+void ResolutionScaler::allocate()
+{
+	release();
+
+	glGenTextures(1, &colour);
+	glBindTexture(GL_TEXTURE_2D, colour);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, window_width, window_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, window_width, window_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colour, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	allocated_width = window_width;
+	allocated_height = window_height;
+}
+
+/*
+	Function to delete the offscreen targets.
+*/
+void ResolutionScaler::release()
+{
+	if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+	if (colour) glDeleteTextures(1, &colour);
+	if (depth) glDeleteRenderbuffers(1, &depth);
+	framebuffer = colour = depth = 0;
+}
+
+/*
+	Function to start rendering a frame into the scaled offscreen target.
+	Reallocates the target first if the window has changed size.
+*/
+void ResolutionScaler::begin()
+{
+	if (allocated_width != window_width || allocated_height != window_height) allocate();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+/*
+	Function to finish the frame, stretching the rendered corner of the offscreen target over the window.
+*/
+void ResolutionScaler::end()
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, window_width, window_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, window_width, window_height);
+}
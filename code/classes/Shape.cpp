@@ -45,17 +45,36 @@ std::vector<glm::vec4> Shape::generateColor(glm::vec4 color)
 	return colors;
 }
 
-std::vector<glm::vec3> Shape::getVertices()
+const std::vector<glm::vec3>& Shape::getVertices()
 {
 	return vertices;
 }
 
-std::vector<glm::vec3> Shape::getNormals()
+const std::vector<glm::vec3>& Shape::getNormals()
 {
 	return normals;
 }
 
-std::vector<glm::vec4> Shape::getColor()
+const std::vector<glm::vec4>& Shape::getColor()
 {
 	return color;
+}
+
+GLsizei Shape::getVertexCount()
+{
+	return (GLsizei)vertices.size();
+}
+
+/*
+	Function to find the corners of the box around the vertices, in the shape's own space.
+	Not every shape is centred on its origin, the tetrahedron rises from its base.
+*/
+void Shape::getBounds(glm::vec3 &min, glm::vec3 &max)
+{
+	min = max = vertices.empty() ? glm::vec3(0.0f) : vertices[0];
+	for (const glm::vec3 &vertex : vertices)
+	{
+		min = glm::min(min, vertex);
+		max = glm::max(max, vertex);
+	}
 }
\ No newline at end of file
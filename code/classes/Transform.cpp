@@ -0,0 +1,176 @@
+/*
+	Transform.cpp
+
+	Batch calculation of the model and normal matrices of every part of every key model.
+	Parts are posed by the piano action as an angle, axis, pivot and offset, held as structure-of-arrays,
+	and transformed together by a kernel that runs with AVX2, SSE or plain scalar code.
+	The path is picked at runtime from the instructions the processor supports.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <cmath>
+#include <glm/glm.hpp> //glm core
+#include "glm/gtc/matrix_transform.hpp" //matrix extension
+#include "Transform.h"
+#include "TransformKernel.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define TRANSFORM_SSE2
+	#include <emmintrin.h> //SSE2 intrinsics
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h> //cpuid
+#endif
+
+using namespace glm;
+
+int transformPartsAVX2(const KernelArgs&, int, int); //defined in TransformAVX2.cpp
+
+namespace
+{
+	//one part at a time, used for processors without SSE and for parts left over from the vector paths
+	struct ScalarOps
+	{
+		typedef float V;
+		static const int WIDTH = 1;
+
+		static V set(float a) { return a; }
+		static V load(const float *p) { return *p; }
+		static void store(float *p, V a) { *p = a; }
+		static V add(V a, V b) { return a + b; }
+		static V sub(V a, V b) { return a - b; }
+		static V mul(V a, V b) { return a * b; }
+		static V fmadd(V a, V b, V c) { return a * b + c; }
+		static V round(V a) { return std::floor(a + 0.5f); }
+		static V neg(V a) { return -a; }
+		static V bitSet(V q, int bit) { return ((int)q & bit) ? 1.0f : 0.0f; }
+		static V select(V mask, V a, V b) { return mask != 0.0f ? a : b; }
+	};
+
+#ifdef TRANSFORM_SSE2
+	//four parts at a time
+	struct SseOps
+	{
+		typedef __m128 V;
+		static const int WIDTH = 4;
+
+		static V set(float a) { return _mm_set1_ps(a); }
+		static V load(const float *p) { return _mm_loadu_ps(p); }
+		static void store(float *p, V a) { _mm_store_ps(p, a); }
+		static V add(V a, V b) { return _mm_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+		static V fmadd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static V round(V a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+		static V neg(V a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+		static V bitSet(V q, int bit)
+		{
+			__m128i b = _mm_set1_epi32(bit);
+			return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_cvtps_epi32(q), b), b));
+		}
+		static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	};
+#endif
+
+	/*
+		Function to detect whether the processor and operating system support AVX2 and FMA.
+	*/
+	bool supportsAVX2()
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!fma || !osxsave || !avx) return false;
+		if ((_xgetbv(0) & 6) != 6) return false; //the operating system must save the AVX registers
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return false;
+#endif
+	}
+}
+
+PartPoses::PartPoses() { }
+
+PartPoses::PartPoses(int parts)
+	: angle(parts), axis_x(parts), axis_y(parts), axis_z(parts, 1.0f),
+	pivot_x(parts), pivot_y(parts), pivot_z(parts), offset_x(parts), offset_y(parts), offset_z(parts) { }
+
+int PartPoses::size()
+{
+	return (int)angle.size();
+}
+
+/*
+	Function to set the pose of one part.
+*/
+void PartPoses::set(int part, GLfloat angle, vec3 axis, vec3 pivot, vec3 offset)
+{
+	this->angle[part] = angle;
+	axis_x[part] = axis.x; axis_y[part] = axis.y; axis_z[part] = axis.z;
+	pivot_x[part] = pivot.x; pivot_y[part] = pivot.y; pivot_z[part] = pivot.z;
+	offset_x[part] = offset.x; offset_y[part] = offset.y; offset_z[part] = offset.z;
+}
+
+/*
+	Function to return the fastest path supported by this processor, detected once.
+*/
+TransformPath transformPath()
+{
+	static TransformPath path = supportsAVX2() ? TRANSFORM_AVX2 :
+#ifdef TRANSFORM_SSE2
+		TRANSFORM_SSE;
+#else
+		TRANSFORM_SCALAR;
+#endif
+	return path;
+}
+
+/*
+	Function to calculate the rotation of the whole object, given the angle around each axis.
+*/
+mat3 objectRotation(vec3 angle)
+{
+	mat4 model = mat4(1.0f);
+	model = rotate(model, -angle.x, vec3(1, 0, 0)); //rotating object around x-axis
+	model = rotate(model, -angle.y, vec3(0, 1, 0)); //rotating object around y-axis
+	model = rotate(model, -angle.z, vec3(0, 0, 1)); //rotating object around z-axis
+	return mat3(model);
+}
+
+/*
+	Function to calculate the model and normal matrix of every posed part.
+	object is the rotation of the whole object and view the rotation part of the camera matrix.
+	The path defaults to the fastest supported; a path the processor lacks falls back to the next one down.
+*/
+void batchTransform(PartPoses &poses, mat3 object, mat3 view, mat4 model[], mat3 normal[], TransformPath path)
+{
+	KernelArgs args =
+	{
+		poses.angle.data(), poses.axis_x.data(), poses.axis_y.data(), poses.axis_z.data(),
+		poses.pivot_x.data(), poses.pivot_y.data(), poses.pivot_z.data(),
+		poses.offset_x.data(), poses.offset_y.data(), poses.offset_z.data(),
+		object, view * object, model, normal
+	};
+	int parts = poses.size();
+	int done = 0;
+
+	if (path == TRANSFORM_AUTO || path > transformPath()) path = transformPath();
+
+	if (path == TRANSFORM_AVX2) done = transformPartsAVX2(args, 0, parts);
+#ifdef TRANSFORM_SSE2
+	if (path != TRANSFORM_SCALAR) done = transformParts<SseOps>(args, done, parts); //also takes the parts left over from AVX2
+#endif
+	transformParts<ScalarOps>(args, done, parts);
+}
@@ -0,0 +1,78 @@
+/*
+	TransformAVX2.cpp
+
+	AVX2 path of the batch transform kernel, eight parts at a time.
+	Kept in its own file so only this code is built for AVX2; batchTransform calls it only
+	after checking the processor supports it, so the program still runs on older processors.
+	MSVC accepts the intrinsics without extra options, GCC and Clang are given the target below.
+*/
+
+#include "wrapper_glfw.h" //glfw wrapper header
+#include <vector>
+#include <glm/glm.hpp> //glm core
+#include "Transform.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+
+#include <immintrin.h> //AVX2 and FMA intrinsics
+
+//build everything below for AVX2 and FMA, the headers above keep the default target
+#if defined(__clang__)
+	#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+	#pragma GCC push_options
+	#pragma GCC target("avx2,fma")
+#endif
+
+#include "TransformKernel.h"
+
+namespace
+{
+	struct AvxOps
+	{
+		typedef __m256 V;
+		static const int WIDTH = 8;
+
+		static V set(float a) { return _mm256_set1_ps(a); }
+		static V load(const float *p) { return _mm256_loadu_ps(p); }
+		static void store(float *p, V a) { _mm256_store_ps(p, a); }
+		static V add(V a, V b) { return _mm256_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+		static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+		static V round(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static V neg(V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+		static V bitSet(V q, int bit)
+		{
+			__m256i b = _mm256_set1_epi32(bit);
+			return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_cvtps_epi32(q), b), b));
+		}
+		static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+	};
+}
+
+/*
+	Function to transform the parts in [begin, end) eight at a time, returning the first part not processed.
+*/
+int transformPartsAVX2(const KernelArgs &args, int begin, int end)
+{
+	return transformParts<AvxOps>(args, begin, end);
+}
+
+#if defined(__clang__)
+	#pragma clang attribute pop
+#elif defined(__GNUC__)
+	#pragma GCC pop_options
+#endif
+
+#else
+
+#include "TransformKernel.h"
+
+//no AVX2 on this architecture, leave every part to the other paths
+int transformPartsAVX2(const KernelArgs &args, int begin, int end)
+{
+	return begin;
+}
+
+#endif
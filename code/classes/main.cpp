@@ -12,6 +12,14 @@
 #include "wrapper_glfw.h" //glfw wrapper header
 #include <vector>
 #include <iostream> //input/output
+#include <thread> //worker threads for model generation and the simulation
+#include <mutex>
+#include <functional>
+#include <deque>
+#include <chrono> //frame pacing clock
+#include <atomic>
+#include <cstdint>
+#include <string>
 #include <glm/glm.hpp> //glm core
 #include "glm/gtc/matrix_transform.hpp" //matrix extension
 #include <glm/gtc/type_ptr.hpp>
@@ -20,6 +28,17 @@
 #include "Tetrahedron.h"
 #include "Cylinder.h"
 #include "Piano.h"
+#include "Transform.h"
+#include "ActionClip.h"
+#include "Action.h"
+#include "KeyRig.h"
+#include "ResolutionScaler.h"
+#include "FramePacer.h"
+#include "NoteRing.h"
+#include "TripleBuffer.h"
+#include "Picker.h"
+#include "Culler.h"
+#include "RenderQueue.h"
 #include "main.h"
 
 using namespace std;
@@ -47,19 +66,36 @@ void initialise(GLWrapper *glw)
 	glGenVertexArrays(1, &vao); //generate index (name) for one vertex array object	
 	glBindVertexArray(vao); //create the vertex array object and make it current
 
-	//initialise the piano key models
+	//initialise the piano key states
 	for (int i = 0; i < MODELS; i++)
 	{
 		MOVING_UP[i] = MOVING_DOWN[i] = false; //key is not currently moving
 		INCREMENT[i] = 0; //to control angle of lever, currently at resting zero
+		VELOCITY[i] = 0.0f;
+	}
+
+	actionclip.bake(); //bake the key press animation for every hammer velocity
 
+	//generate the piano key models and their rigs on worker threads
+	parallelFor(MODELS, [](int i)
+	{
 		if (i % 2 == 0) //if the key is at position 0, 2, 4
 			piano[i] = Piano("natural"); //make it a white, natural key
 		else //if the key is at position 1, 3
 			piano[i] = Piano("sharp"); //make it a black, sharp key
-	
-		createModel(i); //create the piano key model
-	}
+		rig[i] = KeyRig(piano[i], KEY_HEIGHT);
+
+		//bounding box of each object, for picking and culling
+		for (int shape = 0; shape < OBJECTS; shape++)
+		{
+			vec3 low, high;
+			piano[i].getObjectByIndex(shape).getBounds(low, high);
+			objectCentre[i][shape] = (low + high) / 2.0f;
+			objectHalfsize[i][shape] = (high - low) / 2.0f;
+		}
+	});
+
+	createModels(); //stage and upload every piano key model
 
 	//try load the vertex and fragment shaders, catch if file load is invalid
 	try
@@ -73,6 +109,28 @@ void initialise(GLWrapper *glw)
 		exit(0);
 	}
 
+	//start the resolution scaler at the size of the window
+	int width, height;
+	glfwGetFramebufferSize(glw->getWindow(), &width, &height);
+	resolution = ResolutionScaler(width, height, 1.0 / 60.0);
+
+	//pace frames at 60 per second with at most two queued on the GPU, on top of vsync
+	glfwSwapInterval(vsync ? 1 : 0);
+	pacer = FramePacer(60, 2);
+
+	culler = Culler(MODELS); //cull keys and objects outside the view
+
+	//open the ring external processes write note events into
+	if (notes.create()) cout << "Listening for notes on " << NOTE_RING_NAME << endl;
+	else cout << "Error: cannot create " << NOTE_RING_NAME << ", notes from other processes are off" << endl;
+
+	//take the first snapshot and build the picking hierarchy over it, then step the simulation on its own thread
+	simulateTick();
+	snapshots.update();
+	buildPicker(snapshots.read());
+	simulating = true;
+	simulation = thread(simulate);
+
 	//declare and initialise the uniforms
 	modelID = glGetUniformLocation(program, "model");
 	viewID = glGetUniformLocation(program, "view");
@@ -81,166 +139,334 @@ void initialise(GLWrapper *glw)
 }
 
 /*
-	Function to create the specified model within the specified model.
-	Binds the position, color and normal buffers.
-	Data fetch from shape object, previously generated in createModel.
+	Function to run a task for every index in [0, count), split into contiguous chunks across the hardware threads.
+	The task must only write to data owned by its own index.
 */
-void createObject(int model, Shape object, int index)
+void parallelFor(int count, function<void(int)> task)
 {
-	//positions
-	vector<vec3> positions = object.getVertices();
-	glGenBuffers(1, &positionBuffer[model][index]);
-	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer[model][index]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * positions.size(), positions.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	int workers = (int)thread::hardware_concurrency();
+	if (workers < 1) workers = 1; //hardware_concurrency may be unknown
+	if (workers > count) workers = count;
 
-	//colors
-	vector<vec4> color = object.getColor();
-	glGenBuffers(1, &colorBuffer[model][index]);
-	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer[model][index]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * color.size(), color.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	vector<thread> threads;
+	for (int w = 0; w < workers; w++)
+	{
+		threads.push_back(thread([=]()
+		{
+			for (int i = count * w / workers; i < count * (w + 1) / workers; i++) task(i);
+		}));
+	}
+	for (thread &worker : threads) worker.join();
+}
 
-	//normals
-	vector<vec3> normals = object.getNormals();
-	glGenBuffers(1, &normalsBuffer[model][index]);
-	glBindBuffer(GL_ARRAY_BUFFER, normalsBuffer[model][index]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * normals.size(), normals.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+/*
+	Function to copy the specified object within the specified model into the staging area.
+	Copies the position, color and normal data to the object's offset within the shared buffers.
+	Data read directly from the shape object, previously generated in initialise.
+*/
+void createObject(int model, Shape &object, int index, vector<vec3> &positions, vector<vec4> &colors, vector<vec3> &normals)
+{
+	GLint offset = objectOffset[model][index];
+
+	copy(object.getVertices().begin(), object.getVertices().end(), positions.begin() + offset); //positions
+	copy(object.getColor().begin(), object.getColor().end(), colors.begin() + offset); //colors
+	copy(object.getNormals().begin(), object.getNormals().end(), normals.begin() + offset); //normals
 }
 
 /*
-	Function to create the main outer model, consisting of multiple inner piano key models.
-	Generate as many objects as specified in OBJECTS constant.
-	Fill the objects with data within the Shape class.
+	Function to stage a single piano key model, consisting of the objects specified in OBJECTS constant.
+	Safe to run on a worker thread, as each model owns its own range of the staging area.
 */
-void createModel(int model)
+void createModel(int model, vector<vec3> &positions, vector<vec4> &colors, vector<vec3> &normals)
 {
 	//run through the model objects
 	for (int i = 0; i < OBJECTS; i++)
 	{
-		createObject(model, piano[model].getObjectByIndex(i), i); //create each individual object within the key model
+		createObject(model, piano[model].getObjectByIndex(i), i, positions, colors, normals); //stage each individual object within the key model
 	}
 }
 
 /*
-	Function to bind the object shapes.
-	Binds vertices, colors and normals to the specified model/shape buffer.
+	Function to list the draw calls of the specified shape within the specified model, from its first vertex within the shared buffers.
+	Called once per object as the models are laid out, so queueing a draw needs no lookups.
 */
-void bindObject(int model, int shape)
+vector<DrawItem> objectDrawCalls(int model, int shape)
+{
+	GLint first = objectOffset[model][shape]; //first vertex of the object within the shared buffers
+	int part = model * OBJECTS + shape;
+
+	if (shape != piano[model].getIndexByObject("wire"))
+	{
+		return { { GL_TRIANGLES, first, piano[model].getObjectByIndex(shape).getVertexCount(), part } };
+	}
+
+	//wire is drawn as a cylinder: lid, base and tube
+	GLsizei edge = piano[model].wire.EDGE_POINTS;
+	return
+	{
+		{ GL_TRIANGLE_FAN, first, edge + 2, part },
+		{ GL_TRIANGLE_FAN, first + edge + 2, edge + 2, part },
+		{ GL_TRIANGLE_STRIP, first + 2 * edge + 4, 2 * edge + 2, part }
+	};
+}
+
+/*
+	Function to create the main outer model, consisting of multiple inner piano key models.
+	Lays every object out within one position, color and normal buffer, stages the models on worker threads,
+	then uploads each buffer in a single transfer rather than one transfer per object.
+*/
+void createModels()
+{
+	//assign each object its first vertex within the shared buffers, and the draw calls that draw it from there
+	GLint vertices = 0;
+	for (int model = 0; model < MODELS; model++)
+	{
+		for (int i = 0; i < OBJECTS; i++)
+		{
+			objectOffset[model][i] = vertices;
+			vertices += piano[model].getObjectByIndex(i).getVertexCount();
+			objectDraws[model][i] = objectDrawCalls(model, i);
+		}
+	}
+
+	//models are built here before being uploaded, and released once the data is held by the GPU
+	vector<vec3> positions(vertices), normals(vertices);
+	vector<vec4> colors(vertices);
+
+	parallelFor(MODELS, [&](int model) { createModel(model, positions, colors, normals); }); //fill the staging area
+
+	//positions
+	glGenBuffers(1, &positionBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * positions.size(), positions.data(), GL_STATIC_DRAW);
+
+	//colors
+	glGenBuffers(1, &colorBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * colors.size(), colors.data(), GL_STATIC_DRAW);
+
+	//normals
+	glGenBuffers(1, &normalsBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, normalsBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * normals.size(), normals.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*
+	Function to bind the shared vertex, colour and normal buffers, which hold every object of every model.
+	Each object is drawn from its first vertex within the buffers, so one bind serves them all.
+*/
+void bindBuffers()
 {
 	//bind object vertices, attribute index 0
-	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer[model][shape]);
+	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
 	//bind object colours, attribute index 1
-	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer[model][shape]);
+	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
 	glEnableVertexAttribArray(1);
 	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, 0);
 
 	//bind object normals, attribute index 2
 	glEnableVertexAttribArray(2);
-	glBindBuffer(GL_ARRAY_BUFFER, normalsBuffer[model][shape]);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glBindBuffer(GL_ARRAY_BUFFER, normalsBuffer);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
 }
 
 /*
-	Function to draw the specified shape within the specified model.
-	Handles each object type individually, including:
-	Rotates the key and lever upon key press,
-	Rotates the pivot tetrahedron to position it side on,
-	Translates the hammer/arm and damper/arm upon key press,
-	Vibrates the wire upon hammer contact
+	Function to add the draws of the specified shape within the specified model to the render queue.
 */
-void drawShape(int modelnumber, mat4 View, vec3 translatevec, int shape)
+void queueObject(uint64_t key, int model, int shape)
 {
-	bindObject(modelnumber, shape); //bind the specified shape within the specified model
+	for (const DrawItem &draw : objectDraws[model][shape]) queue.push(key, draw);
+}
 
-	mat4 model = mat4(1.0f); //create the model variable for the shape
-	model = rotate(model, -angle_x, vec3(1, 0, 0)); //rotating object around x-axis
-	model = rotate(model, -angle_y, vec3(0, 1, 0)); //rotating object around y-axis
-	model = rotate(model, -angle_z, vec3(0, 0, 1)); //rotating object around z-axis
+/*
+	Function to draw the sorted render queue.
+	Switches program, binds buffers, starts key groups and uploads matrices only when they differ from the last draw;
+	the scene program is already current, with the camera uniforms set.
+*/
+void drawQueue(const Snapshot &snapshot)
+{
+	const GLuint programs[] = { program }; //programs by their index in the sort key
+	int sortpasses = queue.stats.sortpasses;
+	QueueStats &stats = queue.stats;
+	stats = QueueStats();
+	stats.sortpasses = sortpasses;
 
-	if (shape < 2) //key or lever
-	{
-		//translate back to the origin, rotate around the origin the height required, translate back to original position
-		model = translate(model, pivotpoint);
-		model = rotate(model, INCREMENT[modelnumber] * (18.0f) / LIMIT, vec3(0, 0, 1));
-		model = translate(model, -pivotpoint);
-		model = translate(model, translatevec);
-	}
-	else if (shape == 2) //pivot
-	{
-		//rotate the pivot shape to be side on
-		model = translate(model, pivotpoint);
-		model = rotate(model, 65.0f, vec3(0, 1, 0));
-		model = translate(model, -pivotpoint);
-		model = translate(model, translatevec);
-	}
-	else if (shape >= 3 && shape <= 6) //hammerarm, hammer, damperarm or damper
+	int currentprogram = 0, currentmesh = -1, currentgroup = -1, currentkey = -1, currentpart = -1;
+	mat3 currentnormal;
+
+	for (int i = 0; i < queue.size(); i++)
 	{
-		vec3 difference(0.0); //vector to hold difference between the hammer/damper and the wire
+		uint64_t key = queue.key(i);
+		const DrawItem &draw = queue.item(i);
+		int programindex = RenderQueue::field(key, RenderQueue::PROGRAM_SHIFT, RenderQueue::PROGRAM_BITS);
+		int group = RenderQueue::field(key, RenderQueue::GROUP_SHIFT, RenderQueue::GROUP_BITS);
+		int mesh = RenderQueue::field(key, RenderQueue::MESH_SHIFT, RenderQueue::MESH_BITS);
 
-		if (MOVING_UP[modelnumber] ^ MOVING_DOWN[modelnumber]) //if the model is moving upwards xor model is moving downwards
+		if (programindex != currentprogram)
 		{
-			difference = vec3(0.0, INCREMENT[modelnumber] * (wirecentre - piano[modelnumber].damperarm.height / 2) / LIMIT, 0.0); ///calculate the difference for the hammer/arm
+			glUseProgram(programs[programindex]);
+			currentprogram = programindex;
+			stats.programs++;
+		}
+		else stats.skipped++;
 
-			if (shape > 4) difference += vec3(0.0, INCREMENT[modelnumber] * (0.31f) / LIMIT, 0.0); //calculate the difference for the damper/arm			
+		if (mesh != currentmesh) //every object shares one set of buffers, mesh 0
+		{
+			bindBuffers();
+			currentmesh = mesh;
+			stats.meshes++;
 		}
+		else stats.skipped++;
 
-		model = translate(model, translatevec + difference); //translate the hammer/damper objects to required height
-	}
-	else if (shape == 7) //wire
-	{
-		//rotate the cylinder so it's lying horizontally, parallel to the x-axis
-		model = translate(model, translatevec);
-		model = rotate(model, 90.0f, vec3(0, 0, 1));
-		model = translate(model, vec3(-piano[modelnumber].damper.height / 2 - piano[modelnumber].wire.width / 2, 1.5f, 0.05f));
-		if (MOVING_DOWN[modelnumber]) //if the wire has just been hit with hammer
+		if (group != currentgroup) //a key's draws are grouped together for its occlusion query
 		{
-			//vibrate the wire
-			float offset = sin(3.5f * 3.141592f * INCREMENT[modelnumber] * 100);
-			model = translate(model, vec3(offset + 0.05f, offset, offset));
+			if (currentkey >= 0) culler.endQuery(currentkey);
+			currentkey = draw.part / OBJECTS;
+			culler.beginQuery(currentkey);
+			currentgroup = group;
+			stats.groups++;
 		}
+
+		if (draw.part != currentpart)
+		{
+			int model = draw.part / OBJECTS, shape = draw.part % OBJECTS;
+			glUniformMatrix4fv(modelID, 1, GL_FALSE, &snapshot.model[model][shape][0][0]);
+			stats.models++;
+
+			//objects turned only by the object rotation share a normal matrix
+			if (currentpart < 0 || objectNormal[model][shape] != currentnormal)
+			{
+				currentnormal = objectNormal[model][shape];
+				glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &currentnormal[0][0]);
+				stats.normals++;
+			}
+			else stats.skipped++;
+			currentpart = draw.part;
+		}
+		else stats.skipped += 2;
+
+		glDrawArrays(draw.mode, draw.first, draw.count);
+		stats.draws++;
 	}
-	glUniformMatrix4fv(modelID, 1, GL_FALSE, &model[0][0]);
 
-	mat3 normalmatrix = transpose(inverse(mat3(View * model))); //define normal matrix
-	glUniformMatrix3fv(normalmatrixID, 1, GL_FALSE, &normalmatrix[0][0]);
+	if (currentkey >= 0) culler.endQuery(currentkey);
 }
 
-/* 
-	Called to update the display. 
-	This function is called in the event loop in the wrapper class.
+/*
+	Function to drain the note ring and start the key of every note played.
+	Notes 60 (middle C) upwards map onto the models in order, releases and other notes are ignored.
+	The MIDI velocity, 1 to 127, sets how hard the hammer strikes.
 */
-void display()
+void playNotes()
 {
-	//run through the array of models
-	for (int i = 0; i < MODELS; i++)
+	NoteEvent events[256];
+	int count;
+
+	while ((count = notes.drain(events, 256)) > 0)
 	{
-		if (INCREMENT[i] == LIMIT) //if the key has reached maximum height
+		for (int i = 0; i < count; i++)
 		{
-			MOVING_UP[i] = false; //key is no longer moving up
-			MOVING_DOWN[i] = true; //key is now moving down
-		}
-		else if (MOVING_DOWN[i] && INCREMENT[i] == 0) //if the key is moving down and the minimum height is reached
-		{
-			MOVING_DOWN[i] = false; //object is no longer moving down
-			OBJECTS_MOVING--; //remove the objects from the count of objects currently moving
+			int model = events[i].note - 60;
+			if (events[i].velocity > 0 && model >= 0 && model < MODELS) moveHammer(model, (events[i].velocity - 1) / 126.0f);
 		}
 	}
+}
 
-	glClearColor(0.19f, 0.05f, 0.12f, 1.0f); //background color of dark purple
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //clear color and frame buffers
-	glEnable(GL_DEPTH_TEST); //enable depth test
-	glUseProgram(program); //make the compiled shader program current
+/*
+	Function to queue input to be run on the simulation thread at the start of its next tick.
+*/
+void post(function<void()> command)
+{
+	lock_guard<mutex> lock(commandlock);
+	commands.push_back(command);
+}
 
-	//projection matrix
-	mat4 Projection = perspective(45.0f, aspect_ratio, 0.1f, 100.0f); //45 Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units
-	glUniformMatrix4fv(projectionID, 1, GL_FALSE, &Projection[0][0]); 
+/*
+	Function to step the simulation by one tick.
+	Runs the queued input, steps the keys and poses every object, then publishes the result as a snapshot.
+	Only called on the simulation thread once it has started, the only thread to touch the key states.
+*/
+void simulateTick()
+{
+	static unsigned long long ticks = 0;
 
-	//camera matrix
+	//run the input queued since the last tick
+	vector<function<void()>> pending;
+	{
+		lock_guard<mutex> lock(commandlock);
+		pending.swap(commands);
+	}
+	for (function<void()> &command : pending) command();
+
+	playNotes(); //start the keys played by other processes since the last tick
+
+	updateKeys(MODELS, MOVING_UP, MOVING_DOWN, INCREMENT, LIMIT, OBJECTS_MOVING); //change direction of keys at the top or bottom of their movement
+
+	float zpos = -2.0f; //where to place the first model upon the z-axis
+
+	//pose every object within every model
+	for (int model = 0; model < MODELS; model++)
+	{
+		vec3 initial = vec3(0 - 2.0f, KEY_HEIGHT, zpos / 3.6); //set the initial position of the model
+		ActionSample action = actionclip.sample(VELOCITY[model], ActionClip::phase(INCREMENT[model], LIMIT, MOVING_UP[model], MOVING_DOWN[model])); //look up the key press
+		rig[model].pose(initial, action, poses, model * OBJECTS);
+
+		zpos += 1.0f; //increment the z-position of the model to place it further up the z-axis
+	}
+
+	//fill the snapshot, calculating the model matrix and rotation of every object in one batch
+	//the picking transforms leave out the object rotation, so turning the object never changes them;
+	//their rotations are overwritten by the second batch
+	Snapshot &snapshot = snapshots.write();
+	snapshot.object = objectRotation(vec3(angle_x, angle_y, angle_z));
+	batchTransform(poses, mat3(1.0f), mat3(1.0f), &snapshot.pick[0][0], &snapshot.rotation[0][0]);
+	batchTransform(poses, snapshot.object, mat3(1.0f), &snapshot.model[0][0], &snapshot.rotation[0][0]);
+	snapshot.notesreceived = notes.received;
+	snapshot.notelatency = notes.meanLatency();
+	snapshot.notelatencymax = notes.latencymax;
+	snapshot.tick = ticks++;
+	snapshots.publish(); //hand the snapshot to the rendering thread
+
+	angle_x += angle_inc_x; //increment the object position on x-axis
+	angle_y += angle_inc_y; //increment the object position on y-axis
+	angle_z += angle_inc_z; //increment teh object position on z-axis
+
+	advanceKeys(MODELS, MOVING_UP, MOVING_DOWN, INCREMENT); //step the position of every moving key arm
+}
+
+/*
+	Function run by the simulation thread, stepping the simulation at the tick rate until told to stop.
+	The key action moves at the same speed whatever the frame rate.
+	Ticks only sleep between each other, as the snapshot is drawn at the frame rate anyway.
+*/
+void simulate()
+{
+	FramePacer ticker(TICK_RATE, 0, false);
+
+	while (simulating)
+	{
+		ticker.wait(); //hold until the next tick is due
+		simulateTick();
+	}
+}
+
+/*
+	Function to return the projection matrix.
+*/
+mat4 projectionMatrix()
+{
+	return perspective(45.0f, aspect_ratio, 0.1f, 100.0f); //45 Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units
+}
+
+/*
+	Function to return the camera matrix.
+*/
+mat4 viewMatrix()
+{
 	mat4 View = lookAt
 	(
 		vec3(0, 0, zoom), //camera is at in world space, accounts for zoom variable
@@ -250,78 +476,131 @@ void display()
 	View = rotate(View, x, vec3(1, 0, 0)); //rotating in clockwise direction around x-axis
 	View = rotate(View, y, vec3(0, 1, 0)); //rotating in clockwise direction around y-axis
 	View = rotate(View, z, vec3(0, 0, 1)); //rotating in clockwise direction around z-axis
+	return View;
+}
+
+/*
+	Function to build the picking hierarchy over the bounding box of every object in the snapshot.
+	Picking works in object space, before the rotation of the whole object.
+*/
+void buildPicker(const Snapshot &snapshot)
+{
+	picker.build(&snapshot.pick[0][0], &objectCentre[0][0], &objectHalfsize[0][0], MODELS * OBJECTS);
+}
+
+/*
+	Function to pick the object under the cursor, and play the key it belongs to.
+	The cursor is unprojected onto the near and far planes, then turned into object space by undoing the object rotation.
+*/
+void pickObject(GLFWwindow* window)
+{
+	double cursor_x, cursor_y;
+	int width, height;
+	glfwGetCursorPos(window, &cursor_x, &cursor_y);
+	glfwGetWindowSize(window, &width, &height);
+	if (width <= 0 || height <= 0) return;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	//cursor position in normalised device coordinates
+	float ndc_x = (float)(2.0 * cursor_x / width - 1.0);
+	float ndc_y = (float)(1.0 - 2.0 * cursor_y / height);
+
+	mat4 unproject = inverse(projectionMatrix() * viewMatrix());
+	vec4 nearpoint = unproject * vec4(ndc_x, ndc_y, -1.0f, 1.0f);
+	vec4 farpoint = unproject * vec4(ndc_x, ndc_y, 1.0f, 1.0f);
+
+	mat3 unrotate = transpose(snapshots.read().object);
+	vec3 origin = unrotate * (vec3(nearpoint) / nearpoint.w);
+	vec3 direction = normalize(unrotate * (vec3(farpoint) / farpoint.w) - origin);
+
+	float distance;
+	int part = picker.pick(origin, direction, distance);
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (part < 0)
+	{
+		cout << "Picked nothing (" << elapsed * 1e6 << "us)" << endl;
+		return;
+	}
+
+	int model = part / OBJECTS;
+	cout << "Picked " << piano[model].getObjectNameByIndex(part % OBJECTS) << " of key " << model << " (" << elapsed * 1e6 << "us)" << endl;
+	post([model] { moveHammer(model); }); //play the picked key
+}
+
+/* 
+	Called to update the display. 
+	This function is called in the event loop in the wrapper class.
+	Draws the latest snapshot published by the simulation thread.
+*/
+void display()
+{
+	pacer.presented(); //the last frame's buffers have been swapped
+	resolution.beginFrame(); //time the frame from here to presenting it
+
+	//take the latest snapshot, if a new one has been published, and refit the picking hierarchy to the objects that moved
+	if (snapshots.update()) picker.update(&snapshots.read().pick[0][0]);
+	const Snapshot &snapshot = snapshots.read();
+
+	//render at the resolution that holds the frame time
+	if (resolution.enabled) resolution.begin(); //render into the scaled offscreen target
+
+	glClearColor(0.19f, 0.05f, 0.12f, 1.0f); //background color of dark purple
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //clear color and frame buffers
+	glEnable(GL_DEPTH_TEST); //enable depth test
+	glUseProgram(program); //make the compiled shader program current
+
+	//projection matrix
+	mat4 Projection = projectionMatrix();
+	glUniformMatrix4fv(projectionID, 1, GL_FALSE, &Projection[0][0]); 
+
+	//camera matrix
+	mat4 View = viewMatrix();
 	glUniformMatrix4fv(viewID, 1, GL_FALSE, &View[0][0]);
 
 	#pragma region Draw Objects
 
-	float zpos = -2.0f; //where to place the first model upon the z-axis
-	
-	//iterate through the models array
+	//the object and camera are pure rotations, so each normal matrix is the camera rotation applied to the object's
+	mat3 view = mat3(View);
+	for (int model = 0; model < MODELS; model++)
+		for (int shape = 0; shape < OBJECTS; shape++)
+			objectNormal[model][shape] = view * snapshot.rotation[model][shape];
+
+	//cull the keys and objects outside the view
+	culler.begin(Projection, View);
+	culler.cull(&snapshot.model[0][0], &objectCentre[0][0], &objectHalfsize[0][0], OBJECTS, &objectVisible[0][0]);
+
+	//queue every visible object of every model, keyed by pass, program, group, mesh and material, then front to back;
+	//while occlusion culling, each key's draws form one group for its query, the groups ranked front to back
+	//so each key is tested against the keys in front of it
+	queue.clear();
 	for (int model = 0; model < MODELS; model++)
 	{
-		vec3 initial = vec3(0 - 2.0f, 0 - 1.0f, zpos / 3.6); //set the initial position of the model
-		wirecentre = -1.0f + piano[model].key.height + piano[model].damperarm.height; //hold the wire centre y-position for use later on, needed to detect hammer contact with wire
-
-		//position and draw key
-		vec3 translatevec = initial;
-		drawShape(model, View, translatevec, piano[model].getIndexByObject("key"));
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
-		//position and draw lever
-		translatevec += vec3(piano[model].key.width / 2 + piano[model].lever.width / 2, piano[model].key.height / 2 - piano[model].lever.height / 2, 0);
-		drawShape(model, View, translatevec, piano[model].getIndexByObject("lever"));
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
-		//position and draw pivot
-		translatevec += vec3(-0.8f, -piano[model].pivot.height / 2 - piano[model].lever.height / 2, 0.0);
-		pivotpoint = translatevec + vec3(0.0, piano[model].pivot.height / 2 + piano[model].lever.height / 2, 0.0);
-		drawShape(model, View, translatevec, piano[model].getIndexByObject("pivot"));
-		glDrawArrays(GL_TRIANGLES, 0, 12);
-
-		//position and draw hammerarm
-		translatevec += vec3(0.8f, piano[model].pivot.height / 2 + piano[model].lever.height + piano[model].hammerarm.height / 2, 0.0);
-		drawShape(model, View, translatevec, piano[model].getIndexByObject("hammerarm"));
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
-		//position and draw hammer
-		translatevec += vec3(0.0, piano[model].hammerarm.height / 2 + piano[model].hammer.height / 2, 0.0);
-		drawShape(model, View, translatevec, piano[model].getIndexByObject("hammer"));
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
-		//position and draw damperarm
-		translatevec += vec3(1.0f, -piano[model].hammer.height / 2 - piano[model].hammerarm.height + piano[model].damperarm.height / 2, 0.0);
-		drawShape(model, View, translatevec, piano[model].getIndexByObject("damperarm"));
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
-		//position and draw damper
-		translatevec += vec3(0.0, piano[model].damperarm.height / 2 + piano[model].damper.height / 2, 0.0);
-		drawShape(model, View, translatevec, piano[model].getIndexByObject("damper"));
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
-		//position and draw wire
-		drawShape(model, View, translatevec, piano[model].getIndexByObject("wire"));
-		glDrawArrays(GL_TRIANGLE_FAN, 0, piano[model].wire.EDGE_POINTS + 2);
-		glDrawArrays(GL_TRIANGLE_FAN, piano[model].wire.EDGE_POINTS + 2, piano[model].wire.EDGE_POINTS + 2);
-		glDrawArrays(GL_TRIANGLE_STRIP, 2 * piano[model].wire.EDGE_POINTS + 4, 2 * piano[model].wire.EDGE_POINTS + 2);
+		if (!culler.drawKey(model)) continue; //key is out of view or hidden
+		int group = culler.mode == CULL_OCCLUSION ? culler.rank(model) : 0;
 
-		zpos += 1.0f; //increment the z-position of the model to place it further up the z-axis
+		for (int shape = 0; shape < OBJECTS; shape++)
+		{
+			if (!objectVisible[model][shape]) continue;
+			float depth = -(View * snapshot.model[model][shape][3]).z; //distance of the object's centre in front of the camera
+			queueObject(RenderQueue::makeKey(0, 0, group, 0, shape, depth, 100.0f), model, shape);
+		}
 	}
+	queue.sort();
+	drawQueue(snapshot);
+
+	culler.queryHidden(modelID); //test whether hidden keys have come back into view
 
 	#pragma	endregion
 
 	glDisableVertexAttribArray(0);
 	glUseProgram(0);
 
-	angle_x += angle_inc_x; //increment the object position on x-axis
-	angle_y += angle_inc_y; //increment the object position on y-axis
-	angle_z += angle_inc_z; //increment teh object position on z-axis
+	if (resolution.enabled) resolution.end(); //stretch the scaled scene over the window
+	resolution.endFrame(); //adjust the resolution to the time spent rendering, before waiting for the deadline
 
-	//iterate through the model collection
-	for (int j = 0; j < MODELS; j++)
-	{
-		if (MOVING_UP[j]) INCREMENT[j]++; //if the model is currently moving upwards, increase the position of the key arm
-		if (MOVING_DOWN[j]) INCREMENT[j]--; //if the model is currently moving downwards, decrease the position of the key arm
-	}
+	pacer.wait(); //hold the frame until it is due to be presented
 }
 
 /* 
@@ -332,20 +611,30 @@ static void reshape(GLFWwindow* window, int w, int h)
 {
 	glViewport(0, 0, (GLsizei)w, (GLsizei)h);
 	aspect_ratio = ((float)w / 640.f*4.f) / ((float)h / 480.f*3.f);
+	resolution.resize(w, h); //scaled resolution follows the window size
 }
 
 /*
-	Function to move the hammer of the specified model.
+	Function to move the hammer of the specified model, striking at the given velocity from 0 to 1.
 */
-void moveHammer(int model)
+void moveHammer(int model, GLfloat velocity)
 {
 	if (!MOVING_UP[model] && !MOVING_DOWN[model]) //if the key is not currently moving
 	{
 		MOVING_UP[model] = true; //trigger the model to begin moving
+		VELOCITY[model] = velocity > 1.0f ? 1.0f : (velocity < 0.0f ? 0.0f : velocity);
 		OBJECTS_MOVING++; //increment the number of currently moving objects by 1
 	}
 }
 
+/*
+	Function to move the hammer of the specified model, striking at the velocity of the current hammer speed.
+*/
+void moveHammer(int model)
+{
+	moveHammer(model, ActionClip::velocity(LIMIT));
+}
+
 /*
 	This function decreases the speed of the hammer.
 	This is called whenever the user presses the assigned decrease speed key.
@@ -388,6 +677,97 @@ void incSpeed()
 	else cout << "Error: cannot change speed whilst key is moving" << endl; //if objects are currently moving (hammer speed cannot be altered when objects are moving)
 }
 
+/*
+	Function to toggle dynamic resolution scaling.
+	Each frame is rendered at a reduced resolution when needed to hold the frame time.
+*/
+void toggleResolution()
+{
+	resolution.enabled = !resolution.enabled;
+	cout << "Dynamic resolution: " << (resolution.enabled ? "on" : "off") << endl;
+}
+
+/*
+	Function to cycle the target frame rate through 30, 60 and 120 frames per second, then uncapped.
+	The dynamic resolution target follows the frame rate.
+*/
+void cycleFrameRate()
+{
+	int rate = pacer.rate == 30 ? 60 : (pacer.rate == 60 ? 120 : (pacer.rate == 120 ? 0 : 30));
+	pacer.setRate(rate);
+	resolution.target = 1.0 / (rate > 0 ? rate : 60);
+
+	if (rate > 0) cout << "Frame rate: " << rate << "fps" << endl;
+	else cout << "Frame rate: uncapped" << endl;
+}
+
+/*
+	Function to toggle vsync. Frames are paced to the target rate either way;
+	with vsync off they are presented as soon as they are released, which can tear.
+*/
+void toggleVsync()
+{
+	vsync = !vsync;
+	glfwSwapInterval(vsync ? 1 : 0);
+	cout << "Vsync: " << (vsync ? "on" : "off") << endl;
+}
+
+/*
+	Function to cycle the number of frames allowed to queue ahead of the GPU between 1, 2 and unlimited.
+	Fewer queued frames lower the delay between a key press and seeing it, at some cost to throughput.
+*/
+void cycleQueueLimit()
+{
+	pacer.maxqueued = pacer.maxqueued == 1 ? 2 : (pacer.maxqueued == 2 ? 0 : 1);
+
+	if (pacer.maxqueued > 0) cout << "Frames queued: at most " << pacer.maxqueued << endl;
+	else cout << "Frames queued: unlimited" << endl;
+}
+
+/*
+	Function to cycle the culling through frustum culling, frustum and occlusion culling, then none.
+*/
+void cycleCulling()
+{
+	culler.mode = culler.mode == CULL_FRUSTUM ? CULL_OCCLUSION : (culler.mode == CULL_OCCLUSION ? CULL_NONE : CULL_FRUSTUM);
+
+	const char* modes[] = { "off", "frustum", "frustum and occlusion" };
+	cout << "Culling: " << modes[culler.mode] << endl;
+}
+
+/*
+	Function to print the rendering statistics to the console.
+	This is called whenever the user presses the assigned stats key.
+*/
+void printStats()
+{
+	cout << "Render time: " << resolution.frametime * 1000 << "ms (target " << resolution.target * 1000 << "ms)" << endl;
+	if (resolution.enabled)
+		cout << "Resolution: " << resolution.width << "x" << resolution.height << ", " << (int)(resolution.scale * 100 + 0.5f) << "% of window" << endl;
+	else
+		cout << "Resolution: " << resolution.window_width << "x" << resolution.window_height << ", dynamic resolution off" << endl;
+
+	cout << "Present interval: " << pacer.meanInterval() * 1000 << "ms mean, " << pacer.jitter() * 1000 << "ms jitter, "
+		<< pacer.worstInterval() * 1000 << "ms worst, " << pacer.missed << " of " << pacer.frames << " frames missed" << endl;
+
+	//the note statistics belong to the simulation thread, so are read from the snapshot and reset there
+	const Snapshot &snapshot = snapshots.read();
+	cout << "Notes received: " << snapshot.notesreceived << ", latency " << snapshot.notelatency * 1000 << "ms mean, "
+		<< snapshot.notelatencymax * 1000 << "ms worst" << endl;
+	post([] { notes.resetStats(); });
+
+	QueueStats &draws = queue.stats;
+	cout << "Drawing: " << draws.draws << " draws, " << draws.programs << " program switches, " << draws.meshes << " buffer binds, "
+		<< draws.models << " model and " << draws.normals << " normal matrix uploads, " << draws.skipped << " redundant changes skipped, "
+		<< draws.sortpasses << " sort passes" << endl;
+
+	CullStats &cull = culler.stats;
+	cout << "Culling: " << cull.frustumkeys << " of " << cull.keys << " keys and " << cull.frustumparts << " of " << cull.parts << " objects outside the view, "
+		<< cull.occludedkeys << " keys hidden, " << cull.queries << " queries, " << cull.drawnparts << " objects drawn" << endl;
+
+	cout << "Simulation: tick " << snapshot.tick << " drawn, " << TICK_RATE << " ticks per second" << endl;
+}
+
 /* 
 	Function to handle key presses from the user.
 	Handles: anti/clockwise rotation on object/view, individual model movement, zooming in/out, in/decrease speed of hammer.
@@ -409,25 +789,42 @@ static void keyCallback(GLFWwindow* window, int key, int s, int action, int mods
 	if (action != GLFW_PRESS) return; //disable key responses to a held down key
 
 	//you can only increment these keys, no press and hold
-	if (key == 'Q') angle_inc_x -= 0.05f; //rotate object anti-clockwise on x-axis
-	if (key == 'W') angle_inc_x += 0.05f; //rotate object clockwise on x-axis
-	if (key == 'E') angle_inc_y -= 0.05f; //rotate object anti-clockwise on y-axis
-	if (key == 'R') angle_inc_y += 0.05f; //rotate object clockwise on y-axis
-	if (key == 'T') angle_inc_z -= 0.05f; //rotate object anti-clockwise on z-axis
-	if (key == 'Y') angle_inc_z += 0.05f; //rotate object clockwise on z-axis
-
-	if (key == 'A') moveHammer(0); //move model 0
-	if (key == 'S') moveHammer(1); //move model 1
-	if (key == 'D') moveHammer(2); //move model 2
-	if (key == 'F') moveHammer(3); //move model 3
-	if (key == 'G') moveHammer(4); //move model 4
-
-	if (key == 'C') decSpeed(); //decrease the speed of the hammer
-	if (key == 'V') incSpeed(); //increase the speed of the hammer
+	//object and key changes are run on the simulation thread
+	if (key == 'Q') post([] { angle_inc_x -= 0.05f; }); //rotate object anti-clockwise on x-axis
+	if (key == 'W') post([] { angle_inc_x += 0.05f; }); //rotate object clockwise on x-axis
+	if (key == 'E') post([] { angle_inc_y -= 0.05f; }); //rotate object anti-clockwise on y-axis
+	if (key == 'R') post([] { angle_inc_y += 0.05f; }); //rotate object clockwise on y-axis
+	if (key == 'T') post([] { angle_inc_z -= 0.05f; }); //rotate object anti-clockwise on z-axis
+	if (key == 'Y') post([] { angle_inc_z += 0.05f; }); //rotate object clockwise on z-axis
+
+	if (key == 'A') post([] { moveHammer(0); }); //move model 0
+	if (key == 'S') post([] { moveHammer(1); }); //move model 1
+	if (key == 'D') post([] { moveHammer(2); }); //move model 2
+	if (key == 'F') post([] { moveHammer(3); }); //move model 3
+	if (key == 'G') post([] { moveHammer(4); }); //move model 4
+
+	if (key == 'C') post(decSpeed); //decrease the speed of the hammer
+	if (key == 'V') post(incSpeed); //increase the speed of the hammer
+
+	if (key == 'B') toggleResolution(); //turn dynamic resolution scaling on or off
+	if (key == 'H') cycleFrameRate(); //change the target frame rate
+	if (key == 'K') cycleCulling(); //change the culling
+	if (key == 'L') cycleQueueLimit(); //change the number of frames queued on the GPU
+	if (key == 'U') toggleVsync(); //turn vsync on or off
+	if (key == 'P') printStats(); //print the rendering statistics
 
 	if (key == GLFW_KEY_ESCAPE)	glfwSetWindowShouldClose(window, GL_TRUE); //quit the program 
 }
 
+/*
+	Function to handle mouse button presses from the user.
+	A left click picks the object under the cursor.
+*/
+static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) pickObject(window);
+}
+
 /*
 	Function to print the program controls to the console.
 	Builds the statement and prints.
@@ -449,11 +846,18 @@ void printControls()
 		"S: play C# key\n"
 		"D: play D key\n"
 		"F: play D# key\n"
-		"G: play E key\n\n"
+		"G: play E key\n"
+		"Left click: pick an object and play its key\n\n"
 		"Z: zoom out\n"
 		"X: zoom in\n\n"
 		"C: decrease speed of hammer\n"
 		"V: increase speed of hammer\n\n"
+		"B: toggle dynamic resolution\n"
+		"H: cycle frame rate (30, 60, 120, uncapped)\n"
+		"K: cycle culling (frustum, frustum and occlusion, off)\n"
+		"L: cycle frames queued on GPU (1, 2, unlimited)\n"
+		"U: toggle vsync\n"
+		"P: print stats\n\n"
 		"ESC: quit program\n"
 		".:.:.:.:.:.:.:.:.:.:.:.:.:.:.:.:.:.\n"
 		"':':':':':':':':':':':':':':':':':'";
@@ -480,11 +884,16 @@ int main(int argc, char* argv[])
 	glw->setRenderer(display); //bind display within event loop
 	glw->setKeyCallback(keyCallback); //bind display within event loop
 	glw->setReshapeCallback(reshape); //bind reshape within event loop
+	glfwSetMouseButtonCallback(glw->getWindow(), mouseButtonCallback); //bind mouse clicks
 
 	initialise(glw); //initialise the window
 
 	glw->eventLoop(); //bind the event loop
 
+	//stop the simulation thread
+	simulating = false;
+	simulation.join();
+
 	delete(glw);
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+
+void updateKeys(int, bool[], bool[], int[], int, int&); //change direction of keys at the top or bottom of their movement
+void advanceKeys(int, bool[], bool[], int[]); //step every moving key one increment
+void placeObjects(Piano&, glm::vec3, glm::vec3[], glm::vec3&); //reference position of each object within a key model
+glm::mat4 objectTransform(Piano&, int, glm::vec3, glm::vec3, GLfloat, glm::vec3, ActionSample); //model matrix of one object
+glm::mat3 normalMatrix(glm::mat4, glm::mat4); //normal matrix of one object
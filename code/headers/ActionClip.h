@@ -0,0 +1,29 @@
+#pragma once
+
+//position of every moving part of a key at one moment of a key press
+struct ActionSample
+{
+	GLfloat key; //angle of the key and lever, in degrees
+	GLfloat hammer; //lift of the hammer/arm, as a fraction of the distance to the wire
+	GLfloat damper; //lift of the damper/arm, as a fraction of its full travel
+	GLfloat wire; //displacement of the vibrating wire
+};
+
+class ActionClip
+{
+	private:
+		std::vector<ActionSample> samples; //one row of SAMPLES per velocity
+
+		ActionSample evaluate(GLfloat, GLfloat);
+
+	public:
+		const static int VELOCITIES = 10; //number of hammer velocities baked
+		const static int SAMPLES = 256; //number of samples across each key press
+
+		ActionClip();
+		void bake();
+		ActionSample sample(GLfloat, GLfloat);
+
+		static GLfloat velocity(int);
+		static GLfloat phase(int, int, bool, bool);
+};
@@ -4,7 +4,7 @@
 
 class Cuboid : public Shape
 {
-	private:
+	protected:
 		std::vector<glm::vec3> generateVertices();
 
 	public:
@@ -0,0 +1,49 @@
+#pragma once
+
+//how much of the scene is culled before drawing
+enum CullMode { CULL_NONE, CULL_FRUSTUM, CULL_OCCLUSION };
+
+//what was culled in one frame
+struct CullStats
+{
+	int keys, parts; //keys and parts tested
+	int frustumkeys, frustumparts; //keys and parts outside the view, the parts including those of keys outside
+	int occludedkeys; //keys in view but hidden behind others
+	int queries; //occlusion queries issued
+	int drawnparts; //parts left to draw
+};
+
+class Culler
+{
+	private:
+		glm::vec4 planes[6]; //view frustum, in world space, normals pointing inwards
+		glm::vec3 camera; //position of the camera in world space
+		glm::mat4 view; //camera matrix of the frame
+		std::vector<glm::vec3> keymin, keymax; //world space bounds of each key
+		std::vector<char> inview; //key is at least partly inside the view frustum
+		std::vector<int> ranks; //place of each key counting front to back from the camera
+		std::vector<int> visibleparts; //parts of each key inside the view frustum
+		std::vector<char> occluded; //key was hidden at its last query
+		std::vector<char> pending; //key has a query whose result has not been read
+		std::vector<GLuint> queries; //occlusion query of each key
+		GLuint boxbuffer; //unit cube drawn as the stand in for a hidden key
+
+		void allocate();
+		void release();
+		int testBox(glm::vec3, glm::vec3);
+		void readQuery(int);
+
+	public:
+		CullMode mode;
+		CullStats stats; //of the last frame
+
+		Culler();
+		Culler(int);
+		void begin(glm::mat4, glm::mat4);
+		void cull(const glm::mat4[], const glm::vec3[], const glm::vec3[], int, char[]);
+		bool drawKey(int);
+		int rank(int);
+		void beginQuery(int);
+		void endQuery(int);
+		void queryHidden(GLint);
+};
@@ -7,6 +7,7 @@ class Cylinder : public Shape
 	private:
 		GLfloat diameter;
 
+	protected:
 		std::vector<glm::vec3> generateVertices();
 		std::vector<glm::vec3> generateNormals();
 
@@ -0,0 +1,33 @@
+#pragma once
+
+class FramePacer
+{
+	private:
+		std::chrono::steady_clock::time_point deadline; //when the next frame should be presented
+		std::chrono::steady_clock::time_point lastpresent; //when the last frame was seen presented
+		double spinmargin; //seconds before the deadline to stop sleeping and start spinning
+		std::deque<GLsync> fences; //one fence per frame still being rendered by the GPU
+		std::vector<double> intervals; //recent present-to-present intervals, in seconds
+		int nextinterval; //where the next interval is recorded in the ring
+
+		void sleepUntil(std::chrono::steady_clock::time_point);
+		void limitQueue();
+
+	public:
+		const static int HISTORY = 240; //number of intervals kept for the statistics
+
+		int rate; //target frames per second, 0 for uncapped
+		int maxqueued; //frames the GPU may fall behind by, 0 for no limit
+		bool spin; //spin out the end of each wait for precision, off to only sleep
+		int frames; //frames paced since the rate was set
+		int missed; //frames presented a whole period or more late
+
+		FramePacer();
+		FramePacer(int, int, bool = true);
+		void setRate(int);
+		void wait();
+		void presented();
+		double meanInterval();
+		double jitter();
+		double worstInterval();
+};
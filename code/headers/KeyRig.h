@@ -0,0 +1,35 @@
+#pragma once
+
+//ways a part of the key model can move, each posed by its own specialised function
+enum MotionType { MOTION_KEY, MOTION_FIXED, MOTION_HAMMER, MOTION_DAMPER, MOTION_WIRE, MOTION_TYPES };
+
+//one part of the key model
+struct RigPart
+{
+	int object; //index of the object within the Piano, as in getObjectByIndex
+	int parent; //earlier part this one is placed from, -1 to place it at the initial position of the key
+	glm::vec3 offset; //position relative to the parent
+	MotionType motion; //how the part moves
+	GLfloat angle; //rotation in degrees, for the fixed and wire parts
+	glm::vec3 axis; //axis of rotation
+	glm::vec3 motionoffset; //translation after the rotation, for the wire
+	GLfloat travel; //distance lifted at the full stroke of the action, for the hammer and damper parts
+};
+
+class KeyRig
+{
+	private:
+		std::vector<RigPart> parts; //sorted so each parent comes before its children
+		std::vector<int> motions[MOTION_TYPES]; //parts of each motion type
+		int pivotpart; //part the point of pivot is placed from
+		glm::vec3 pivotoffset; //point of pivot relative to that part
+
+		void add(RigPart);
+
+	public:
+		KeyRig();
+		KeyRig(Piano&, GLfloat);
+		int size();
+		void place(glm::vec3, glm::vec3[], glm::vec3&);
+		void pose(glm::vec3, ActionSample, PartPoses&, int);
+};
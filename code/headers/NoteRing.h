@@ -0,0 +1,96 @@
+#pragma once
+
+/*
+	NoteRing.h
+
+	Single-producer, single-consumer ring of timestamped note events in shared memory,
+	so a separate process such as a MIDI or controller daemon can play the model.
+	The piano creates the ring as the consumer, a producer process opens it by name.
+	Pushing and draining only touch the shared memory, neither end makes a system call.
+	Include <atomic>, <cstdint> and <string> first; build with classes/NoteRing.cpp (link -lrt on older Linux).
+*/
+
+#define NOTE_RING_NAME "/piano_notes" //default name of the shared memory
+
+//one note played or released, 16 bytes
+struct NoteEvent
+{
+	uint64_t time; //when the event happened, in nanoseconds on the NoteRing::now() clock
+	int32_t note; //MIDI note number, middle C is 60
+	int32_t velocity; //MIDI velocity 1 to 127, 0 to release the note
+};
+
+//layout of the shared memory, the same in every process
+struct NoteRingMemory
+{
+	const static uint32_t MAGIC = 0x50494E4F; //"PINO", set once the consumer has initialised the ring
+	const static uint32_t VERSION = 1;
+	const static uint32_t CAPACITY = 4096; //events, a power of two
+
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	uint32_t capacity;
+	alignas(64) std::atomic<uint64_t> head; //events written, only stored by the producer
+	alignas(64) std::atomic<uint64_t> tail; //events read, only stored by the consumer
+	alignas(64) NoteEvent events[CAPACITY];
+};
+
+//mapping of the shared memory, common to both ends
+class NoteRing
+{
+	protected:
+		NoteRingMemory *memory;
+		std::string name;
+		bool owner; //this end created the shared memory
+#ifdef _WIN32
+		void *handle;
+#else
+		int fd;
+#endif
+
+		bool map(const char*, bool);
+
+	public:
+		NoteRing();
+		~NoteRing();
+		NoteRing(const NoteRing&) = delete;
+		NoteRing& operator=(const NoteRing&) = delete;
+
+		bool isOpen();
+		void close();
+		static uint64_t now(); //monotonic time in nanoseconds, the same clock in every process
+};
+
+//writing end, used by the external process
+class NoteProducer : public NoteRing
+{
+	private:
+		uint64_t cachedtail; //last tail read, so the consumer's cache line is only read when the ring looks full
+
+	public:
+		uint64_t sent; //events pushed
+		uint64_t dropped; //events lost as the ring was full
+
+		NoteProducer();
+		bool open(const char* = NOTE_RING_NAME);
+		bool push(NoteEvent);
+		bool push(int, int);
+};
+
+//reading end, drained by the piano each frame
+class NoteConsumer : public NoteRing
+{
+	private:
+		uint64_t cachedhead; //last head read, so the producer's cache line is only read when the ring looks empty
+
+	public:
+		uint64_t received; //events drained since the statistics were reset
+		double latencysum; //total time from event to drain, in seconds
+		double latencymax; //longest time from event to drain, in seconds
+
+		NoteConsumer();
+		bool create(const char* = NOTE_RING_NAME);
+		int drain(NoteEvent[], int);
+		double meanLatency();
+		void resetStats();
+};
@@ -3,12 +3,15 @@
 class Piano
 {
 	public:
+		const static int OBJECTS = 8; //number of objects in the model
+
 		Cuboid key, lever, damperarm, damper, hammerarm, hammer;
 		Tetrahedron pivot;
 		Cylinder wire;
 
 		Piano();
 		Piano(std::string);
-		Shape getObjectByIndex(int);
+		Shape& getObjectByIndex(int);
 		int getIndexByObject(std::string);
+		std::string getObjectNameByIndex(int);
 };
\ No newline at end of file
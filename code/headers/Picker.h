@@ -0,0 +1,35 @@
+#pragma once
+
+class Picker
+{
+	private:
+		//node of the bounding volume hierarchy, a leaf holds one part
+		struct Node
+		{
+			glm::vec3 min, max; //bounds, in object space
+			int left, right; //children, -1 for a leaf
+			int parent; //-1 for the root
+			int part; //part held by a leaf, -1 otherwise
+			bool dirty; //waiting to be refitted
+		};
+
+		std::vector<Node> nodes; //root first, parents before their children
+		std::vector<int> leaves; //leaf node of each part
+		std::vector<glm::mat4> transforms; //transform of each part, from its own space to object space
+		std::vector<glm::vec3> centres; //centre of each part's box, in its own space
+		std::vector<glm::vec3> halfsizes; //half the width, height and depth of each part's box
+		std::vector<int> dirty; //nodes waiting to be refitted
+
+		void partBounds(int, glm::vec3&, glm::vec3&);
+		int build(std::vector<int>&, int, int, int);
+		bool hitBox(glm::vec3, glm::vec3, glm::vec3, glm::vec3, float&);
+
+	public:
+		int refitted; //nodes refitted by the last update
+
+		Picker();
+		void build(const glm::mat4[], const glm::vec3[], const glm::vec3[], int);
+		void update(const glm::mat4[]);
+		int pick(glm::vec3, glm::vec3, float&);
+		int size();
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+//one draw call, and the object whose matrices it is drawn with
+struct DrawItem
+{
+	GLenum mode; //primitive type
+	GLint first; //first vertex within the shared buffers
+	GLsizei count; //number of vertices
+	int part; //object index, model * OBJECTS + shape
+};
+
+//state changes and draws made while drawing the queue in one frame
+struct QueueStats
+{
+	int draws; //draw calls
+	int programs; //shader program switches
+	int meshes; //vertex buffer binds
+	int groups; //key groups started
+	int models, normals; //model and normal matrix uploads
+	int skipped; //uploads and binds skipped as the state was already set
+	int sortpasses; //radix sort passes run, of the eight possible
+};
+
+class RenderQueue
+{
+	private:
+		std::vector<uint64_t> keys, sortedkeys; //sort keys, as pushed and in sorted order
+		std::vector<int> order, sortedorder; //index of each item, as pushed and in sorted order
+		std::vector<DrawItem> items;
+
+	public:
+		//fields of the sort key, highest first: pass, program, group, mesh, material, then depth front to back
+		const static int PASS_SHIFT = 60, PROGRAM_SHIFT = 52, GROUP_SHIFT = 36, MESH_SHIFT = 28, MATERIAL_SHIFT = 20;
+		const static int PASS_BITS = 4, PROGRAM_BITS = 8, GROUP_BITS = 16, MESH_BITS = 8, MATERIAL_BITS = 8, DEPTH_BITS = 20;
+		const static uint64_t DEPTH_MAX = (1 << DEPTH_BITS) - 1;
+
+		QueueStats stats; //of the last frame
+
+		RenderQueue();
+		static uint64_t makeKey(int, int, int, int, int, float, float);
+		static int field(uint64_t, int, int);
+		void clear();
+		void push(uint64_t, DrawItem);
+		void sort();
+		int size();
+		uint64_t key(int);
+		const DrawItem& item(int);
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+class ResolutionScaler
+{
+	private:
+		GLuint framebuffer, colour, depth; //offscreen target, allocated at the full window size
+		int allocated_width, allocated_height; //size the offscreen target was allocated at
+		int settling; //frames left before the smoothed frame time reflects the last back off
+		const static int TIMERS = 4; //frames a timer query may be in flight for
+
+		GLuint timers[TIMERS]; //GPU timer queries of recent frames, used in turn
+		bool timing[TIMERS]; //query has been issued and its result not yet read
+		int nexttimer; //query the next frame is timed with
+		double framestart; //time the frame being rendered started, in seconds
+		double gputime; //GPU time of the latest frame read back, in seconds
+
+		void allocate();
+		void release();
+		void readTimers();
+
+	public:
+		const static int MIN_PERCENT = 25; //lowest scale, as a percentage of the window size
+		const static int SETTLE_FRAMES = 22; //frames for the smoothed frame time to follow 90% of a change
+
+		bool enabled; //render offscreen at a scaled resolution
+		double target; //frame time to hold, in seconds
+		double frametime; //smoothed time to render a frame, on the CPU and GPU together, in seconds
+		GLfloat scale; //fraction of the window resolution being rendered
+		int window_width, window_height; //size of the window framebuffer
+		int width, height; //size being rendered
+
+		ResolutionScaler();
+		ResolutionScaler(int, int, double);
+		void resize(int, int);
+		void update(double);
+		void beginFrame();
+		void endFrame();
+		void begin();
+		void end();
+};
@@ -18,7 +18,9 @@ class Shape
 		Shape();
 		Shape(GLfloat, GLfloat, glm::vec4);
 		Shape(GLfloat, GLfloat, GLfloat, glm::vec4);
-		std::vector<glm::vec3> getVertices();
-		std::vector<glm::vec3> getNormals();
-		std::vector<glm::vec4> getColor();
+		const std::vector<glm::vec3>& getVertices();
+		const std::vector<glm::vec3>& getNormals();
+		const std::vector<glm::vec4>& getColor();
+		GLsizei getVertexCount();
+		void getBounds(glm::vec3&, glm::vec3&);
 };
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 class Tetrahedron : public Shape
 {
-	private:
+	protected:
 		std::vector<glm::vec3> generateVertices();
 
 	public:
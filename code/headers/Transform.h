@@ -0,0 +1,23 @@
+#pragma once
+
+//instruction sets the batch transform can run with
+enum TransformPath { TRANSFORM_AUTO, TRANSFORM_SCALAR, TRANSFORM_SSE, TRANSFORM_AVX2 };
+
+class PartPoses
+{
+	public:
+		//each part is placed by rotating it around the pivot, after translating it to its offset
+		std::vector<float> angle; //rotation in degrees
+		std::vector<float> axis_x, axis_y, axis_z; //unit axis of rotation
+		std::vector<float> pivot_x, pivot_y, pivot_z; //point of rotation
+		std::vector<float> offset_x, offset_y, offset_z; //position before rotation
+
+		PartPoses();
+		PartPoses(int);
+		int size();
+		void set(int, GLfloat, glm::vec3, glm::vec3, glm::vec3);
+};
+
+TransformPath transformPath(); //fastest path supported by this processor
+glm::mat3 objectRotation(glm::vec3); //rotation of the whole object, given the angle around each axis
+void batchTransform(PartPoses&, glm::mat3, glm::mat3, glm::mat4[], glm::mat3[], TransformPath = TRANSFORM_AUTO); //model and normal matrix of every part
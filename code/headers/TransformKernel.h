@@ -0,0 +1,144 @@
+#pragma once
+
+/*
+	TransformKernel.h
+
+	Batch transform kernel shared by the scalar, SSE and AVX2 paths of batchTransform.
+	Included only by Transform.cpp and TransformAVX2.cpp, which each supply an Ops type giving
+	the vector type, its width and its arithmetic, so every path runs the same sequence of operations.
+	The parts are read as structure-of-arrays, WIDTH parts at a time, one part per vector lane.
+*/
+
+//inputs and outputs of one batch, laid out the same in every translation unit
+struct KernelArgs
+{
+	const float *angle, *axis_x, *axis_y, *axis_z, *pivot_x, *pivot_y, *pivot_z, *offset_x, *offset_y, *offset_z;
+	glm::mat3 object; //rotation of the whole object
+	glm::mat3 viewobject; //rotation of the camera applied to the object rotation
+	glm::mat4 *model;
+	glm::mat3 *normal;
+};
+
+namespace
+{
+	/*
+		Function to calculate the sine and cosine of each lane, in radians.
+		Reduces to the range [-pi/4, pi/4] around the nearest multiple of pi/2,
+		then uses the minimax polynomials from the Cephes library, accurate to single precision.
+	*/
+	template <class Ops>
+	void sinCos(typename Ops::V x, typename Ops::V &s, typename Ops::V &c)
+	{
+		typedef typename Ops::V V;
+
+		//x = q * pi/2 + r, pi/2 is subtracted in three parts to keep the precision of r
+		V q = Ops::round(Ops::mul(x, Ops::set(0.636619772f)));
+		V r = Ops::fmadd(q, Ops::set(-1.5703125f), x);
+		r = Ops::fmadd(q, Ops::set(-4.837512969970703125e-4f), r);
+		r = Ops::fmadd(q, Ops::set(-7.54978995489188216e-8f), r);
+		V r2 = Ops::mul(r, r);
+
+		V ps = Ops::fmadd(r2, Ops::set(-1.9515295891e-4f), Ops::set(8.3321608736e-3f));
+		ps = Ops::fmadd(ps, r2, Ops::set(-1.6666654611e-1f));
+		ps = Ops::fmadd(Ops::mul(ps, r2), r, r);
+
+		V pc = Ops::fmadd(r2, Ops::set(2.443315711809948e-5f), Ops::set(-1.388731625493765e-3f));
+		pc = Ops::fmadd(pc, r2, Ops::set(4.166664568298827e-2f));
+		pc = Ops::fmadd(Ops::mul(pc, r2), r2, Ops::fmadd(r2, Ops::set(-0.5f), Ops::set(1.0f)));
+
+		//an odd quadrant swaps sine and cosine, the second bit of the quadrant sets their signs
+		V swap = Ops::bitSet(q, 1);
+		s = Ops::select(swap, pc, ps);
+		c = Ops::select(swap, ps, pc);
+		s = Ops::select(Ops::bitSet(q, 2), Ops::neg(s), s);
+		c = Ops::select(Ops::bitSet(Ops::add(q, Ops::set(1.0f)), 2), Ops::neg(c), c);
+	}
+
+	/*
+		Function to calculate the model and normal matrices of the parts in [begin, end), WIDTH at a time.
+		Each model matrix is object * translate(pivot) * rotate(angle, axis) * translate(offset - pivot).
+		The object and camera are pure rotations, so the normal matrix is the rotation part of view * model.
+		Returns the first part not processed, as fewer than WIDTH remain.
+	*/
+	template <class Ops>
+	int transformParts(const KernelArgs &args, int begin, int end)
+	{
+		typedef typename Ops::V V;
+		const int WIDTH = Ops::WIDTH;
+
+		//broadcast the shared rotations, indexed [row][column]
+		V O[3][3], N[3][3];
+		for (int row = 0; row < 3; row++)
+		{
+			for (int col = 0; col < 3; col++)
+			{
+				O[row][col] = Ops::set(args.object[col][row]);
+				N[row][col] = Ops::set(args.viewobject[col][row]);
+			}
+		}
+
+		int i = begin;
+		for (; i + WIDTH <= end; i += WIDTH)
+		{
+			V s, c;
+			sinCos<Ops>(Ops::mul(Ops::load(args.angle + i), Ops::set(0.0174532925f)), s, c);
+
+			V a[3] = { Ops::load(args.axis_x + i), Ops::load(args.axis_y + i), Ops::load(args.axis_z + i) };
+			V p[3] = { Ops::load(args.pivot_x + i), Ops::load(args.pivot_y + i), Ops::load(args.pivot_z + i) };
+			V d[3] = { Ops::sub(Ops::load(args.offset_x + i), p[0]), Ops::sub(Ops::load(args.offset_y + i), p[1]), Ops::sub(Ops::load(args.offset_z + i), p[2]) };
+
+			//rotation around the axis, R = c * I + s * [a]x + (1 - c) * a * a^T
+			V t = Ops::sub(Ops::set(1.0f), c);
+			V R[3][3];
+			for (int row = 0; row < 3; row++)
+			{
+				V ta = Ops::mul(t, a[row]);
+				for (int col = 0; col < 3; col++) R[row][col] = Ops::mul(ta, a[col]);
+				R[row][row] = Ops::add(R[row][row], c);
+			}
+			V sa[3] = { Ops::mul(s, a[0]), Ops::mul(s, a[1]), Ops::mul(s, a[2]) };
+			R[0][1] = Ops::sub(R[0][1], sa[2]); R[1][0] = Ops::add(R[1][0], sa[2]);
+			R[0][2] = Ops::add(R[0][2], sa[1]); R[2][0] = Ops::sub(R[2][0], sa[1]);
+			R[1][2] = Ops::sub(R[1][2], sa[0]); R[2][1] = Ops::add(R[2][1], sa[0]);
+
+			//position of the part before the object rotation, pivot + R * (offset - pivot)
+			V u[3];
+			for (int row = 0; row < 3; row++)
+			{
+				u[row] = Ops::fmadd(R[row][0], d[0], Ops::fmadd(R[row][1], d[1], Ops::fmadd(R[row][2], d[2], p[row])));
+			}
+
+			//model rotation, model translation and normal matrix, stored by lane
+			alignas(32) float lanes[21][WIDTH];
+			for (int row = 0; row < 3; row++)
+			{
+				for (int col = 0; col < 3; col++)
+				{
+					Ops::store(lanes[row * 3 + col], Ops::fmadd(O[row][0], R[0][col], Ops::fmadd(O[row][1], R[1][col], Ops::mul(O[row][2], R[2][col]))));
+					Ops::store(lanes[12 + row * 3 + col], Ops::fmadd(N[row][0], R[0][col], Ops::fmadd(N[row][1], R[1][col], Ops::mul(N[row][2], R[2][col]))));
+				}
+				Ops::store(lanes[9 + row], Ops::fmadd(O[row][0], u[0], Ops::fmadd(O[row][1], u[1], Ops::mul(O[row][2], u[2]))));
+			}
+
+			//scatter the lanes into the column-major matrices
+			for (int lane = 0; lane < WIDTH; lane++)
+			{
+				glm::mat4 &model = args.model[i + lane];
+				glm::mat3 &normal = args.normal[i + lane];
+				for (int col = 0; col < 3; col++)
+				{
+					for (int row = 0; row < 3; row++)
+					{
+						model[col][row] = lanes[row * 3 + col][lane];
+						normal[col][row] = lanes[12 + row * 3 + col][lane];
+					}
+					model[col][3] = 0.0f;
+					model[3][col] = lanes[9 + col][lane];
+				}
+				model[3][3] = 1.0f;
+			}
+		}
+
+		return i;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+/*
+	TripleBuffer.h
+
+	Lock-free triple buffer handing whole values from one writer thread to one reader thread.
+	The writer fills its back buffer and publishes it; the reader takes the latest published buffer when it wants one.
+	Neither side ever waits, and a value is never changed once published, so the reader sees it whole.
+	Values the reader did not take in time are overwritten by newer ones.
+	Include <atomic> first.
+*/
+
+template <class T>
+class TripleBuffer
+{
+	private:
+		const static int FRESH = 4; //set on the middle index when it holds a value the reader has not taken
+
+		alignas(64) T buffers[3];
+		alignas(64) std::atomic<int> middle; //buffer passed between the two sides, with the FRESH flag
+		alignas(64) int back; //buffer owned by the writer
+		alignas(64) int front; //buffer owned by the reader
+
+	public:
+		TripleBuffer() : middle(1), back(0), front(2) { }
+
+		/*
+			Function to return the writer's buffer, to be filled before publishing.
+		*/
+		T& write()
+		{
+			return buffers[back];
+		}
+
+		/*
+			Function to publish the writer's buffer, swapping it with the middle buffer.
+		*/
+		void publish()
+		{
+			back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+		}
+
+		/*
+			Function to take the latest published buffer, if there is one the reader has not seen.
+			Returns whether the reader's buffer changed.
+		*/
+		bool update()
+		{
+			if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+			front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+			return true;
+		}
+
+		/*
+			Function to return the reader's buffer, unchanged until the next update.
+		*/
+		const T& read()
+		{
+			return buffers[front];
+		}
+};
@@ -1,11 +1,15 @@
 #pragma once
 
 static const int MODELS = 5; //number of piano key models
-static const int OBJECTS = 8; //number of objects in the piano key model
+static const int OBJECTS = Piano::OBJECTS; //number of objects in the piano key model
+static const int TICK_RATE = 60; //simulation ticks per second
+static const GLfloat KEY_HEIGHT = -1.0f; //height every key rests at
 
 Piano piano[MODELS]; //piano models
+KeyRig rig[MODELS]; //placement and motion of the objects within each model
 
-GLuint positionBuffer[MODELS][OBJECTS], colorBuffer[MODELS][OBJECTS], normalsBuffer[MODELS][OBJECTS]; //buffer objects
+GLuint positionBuffer, colorBuffer, normalsBuffer; //buffer objects, shared by every model
+GLint objectOffset[MODELS][OBJECTS]; //first vertex of each object within the shared buffers
 
 GLuint program; //identifier for the shader program
 GLuint vao;	//vertex array (container) object, index of the VAO that is container for buffer objects
@@ -17,14 +21,60 @@ GLfloat zoom; //zoom in and out on the object
 
 bool MOVING_UP[MODELS], MOVING_DOWN[MODELS]; //is the lever currently moving up or down?
 int INCREMENT[MODELS]; //position state of hammer
+GLfloat VELOCITY[MODELS]; //hammer velocity of each key's current press, 0 to 1
 int LIMIT = 150; //determines speed of hammer
 int OBJECTS_MOVING = 0; //number of hammers currently moving
 
-glm::vec3 pivotpoint; //point of pivot
-GLfloat wirecentre; //y-coordinate of the wire's centre
+ActionClip actionclip; //baked animation of a key press
+
+PartPoses poses(MODELS * OBJECTS); //pose of every object within every model
+
+//state of the simulation at one tick, handed whole to the rendering thread
+struct Snapshot
+{
+	unsigned long long tick; //simulation tick the snapshot was taken at
+	glm::mat4 model[MODELS][OBJECTS]; //model matrix of every object
+	glm::mat3 rotation[MODELS][OBJECTS]; //rotation of every object, before the camera
+	glm::mat3 object; //rotation of the whole object
+	glm::mat4 pick[MODELS][OBJECTS]; //model matrix of every object before the object rotation, for picking
+	unsigned long long notesreceived; //note events drained since the note statistics were reset
+	double notelatency, notelatencymax; //mean and longest time from note event to drain, in seconds
+};
+
+TripleBuffer<Snapshot> snapshots; //latest simulation state, written by the simulation thread and drawn by the rendering thread
+std::thread simulation; //steps the keys and poses the objects at the tick rate
+std::atomic<bool> simulating; //simulation thread keeps running while set
+std::mutex commandlock; //guards commands
+std::vector<std::function<void()>> commands; //input waiting to be run on the simulation thread
+
+glm::mat3 objectNormal[MODELS][OBJECTS]; //normal matrix of every object in the snapshot being drawn
+
+glm::vec3 objectCentre[MODELS][OBJECTS]; //centre of the box around every object, in its own space
+glm::vec3 objectHalfsize[MODELS][OBJECTS]; //half the width, height and depth of the box around every object
+
+Culler culler; //skips keys and objects that cannot be seen
+char objectVisible[MODELS][OBJECTS]; //object is inside the view this frame
+
+RenderQueue queue; //draws of the visible objects, sorted to group state changes
+std::vector<DrawItem> objectDraws[MODELS][OBJECTS]; //draw calls of every object within the shared buffers
+static_assert(MODELS <= 1 << RenderQueue::GROUP_BITS, "each key needs its own render queue group for its occlusion query");
+
+Picker picker; //finds the object under the mouse
+
 
 GLfloat aspect_ratio; //deals with resizing of window
 
+ResolutionScaler resolution; //renders at a reduced resolution to hold the frame time
+FramePacer pacer; //presents frames at an even target rate
+bool vsync = true; //swaps wait for the display's vertical blank, off to allow tearing
+NoteConsumer notes; //note events written by other processes
+
 GLuint modelID, viewID, projectionID, normalmatrixID; //uniforms
 
-void createModel(int); //declared to allow calling within initialise
\ No newline at end of file
+void parallelFor(int, std::function<void(int)>); //declared to allow calling within initialise
+void createModels();
+void moveHammer(int, GLfloat); //declared to allow calling within playNotes
+void moveHammer(int); //declared to allow calling within pickObject
+void simulate();
+void simulateTick();
+void buildPicker(const Snapshot&);
\ No newline at end of file
@@ -0,0 +1,118 @@
+/*
+	noteproducer.cpp
+
+	Test producer for the shared memory note ring, standing in for a MIDI or controller daemon.
+	Replays a synthetic note stream at a fixed event rate into a running piano, and reports
+	how many events were sent and dropped. Run with listen in place of the piano to measure
+	the ring on its own: it drains as fast as it can and reports throughput and latency percentiles.
+	The stream walks the five keys of the model (notes 60 to 64), each note played then released,
+	with velocities sweeping the MIDI range.
+
+	Build from the code folder (add -lrt on older Linux):
+		g++ -O2 -std=c++11 -Iheaders tools/noteproducer.cpp classes/NoteRing.cpp -o noteproducer
+	Run:
+		noteproducer [events per second] [seconds]	replay into the piano, default 20000 events for 5 seconds
+		noteproducer listen [seconds]			drain and measure, in place of the piano
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include "NoteRing.h"
+
+using namespace std;
+
+/*
+	Function to replay the synthetic stream at the given rate, spinning between events to keep to the schedule.
+*/
+int produce(double rate, double seconds)
+{
+	NoteProducer producer;
+	if (!producer.open())
+	{
+		cerr << "Error: cannot open " << NOTE_RING_NAME << ", start the piano or noteproducer listen first" << endl;
+		return 1;
+	}
+
+	uint64_t start = NoteRing::now();
+	uint64_t events = (uint64_t)(rate * seconds);
+	double period = 1e9 / rate; //nanoseconds between events
+
+	for (uint64_t i = 0; i < events; i++)
+	{
+		uint64_t due = start + (uint64_t)(i * period);
+		while (NoteRing::now() < due) { } //spin until the event is due
+
+		int note = 60 + (int)((i / 2) % 5); //walk the five keys
+		int velocity = (i % 2) ? 0 : 1 + (int)((i / 2) % 127); //play then release
+		producer.push(note, velocity);
+	}
+
+	double elapsed = (NoteRing::now() - start) * 1e-9;
+	cout << "Sent " << producer.sent << " events in " << elapsed << "s (" << producer.sent / elapsed << " per second), "
+		<< producer.dropped << " dropped as the ring was full" << endl;
+	return 0;
+}
+
+/*
+	Function to create the ring and drain it for the given time, then report throughput and latency.
+*/
+int listen(double seconds)
+{
+	NoteConsumer consumer;
+	if (!consumer.create())
+	{
+		cerr << "Error: cannot create " << NOTE_RING_NAME << endl;
+		return 1;
+	}
+	cout << "Listening on " << NOTE_RING_NAME << " for " << seconds << "s" << endl;
+
+	vector<double> latencies;
+	NoteEvent events[256];
+	uint64_t start = 0, last = 0, end = NoteRing::now() + (uint64_t)(seconds * 1e9);
+
+	while (NoteRing::now() < end)
+	{
+		int count = consumer.drain(events, 256);
+		if (count == 0) continue;
+
+		uint64_t time = NoteRing::now();
+		if (start == 0) start = events[0].time;
+		last = time;
+		for (int i = 0; i < count; i++) latencies.push_back((time - events[i].time) * 1e-9);
+	}
+
+	if (latencies.empty())
+	{
+		cout << "No events received" << endl;
+		return 0;
+	}
+
+	double elapsed = (last - start) * 1e-9;
+	sort(latencies.begin(), latencies.end());
+	cout << "Received " << consumer.received << " events in " << elapsed << "s (" << consumer.received / elapsed << " per second)" << endl;
+	cout << "Latency: " << consumer.meanLatency() * 1e6 << "us mean, "
+		<< latencies[latencies.size() / 2] * 1e6 << "us median, "
+		<< latencies[latencies.size() * 99 / 100] * 1e6 << "us 99th percentile, "
+		<< consumer.latencymax * 1e6 << "us worst" << endl;
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "listen") == 0) return listen(argc > 2 ? atof(argv[2]) : 10.0);
+
+	double rate = argc > 1 ? atof(argv[1]) : 20000.0;
+	double seconds = argc > 2 ? atof(argv[2]) : 5.0;
+	if (rate <= 0.0 || seconds <= 0.0)
+	{
+		cerr << "Usage: noteproducer [events per second] [seconds] | noteproducer listen [seconds]" << endl;
+		return 1;
+	}
+	return produce(rate, seconds);
+}